@@ -73,6 +73,20 @@ identify_tar() {
 	identify_magic_long $(get_magic_long_tar "$@")
 }
 
+# Index the tar file in a single pass, one line per regular file:
+# "<name> <size> <magic> <md5>"
+nand_tar_index() {
+	local file="$1"
+	local cmd="$2"
+
+	$cmd < "$file" | nandtar list
+}
+
+# $(1): index, $(2): member name, $(3): field number
+nand_tar_field() {
+	echo "$1" | awk -v name="$2" -v field="$3" '$1 == name { print $field; exit }'
+}
+
 identify_if_gzip() {
 	if [ "$(identify "$1" "cat")" = gzip ]; then echo -n z; fi
 }
@@ -313,20 +327,25 @@ nand_upgrade_tar() {
 	local cmd="${2:-cat}"
 	local jffs2_markers="${CI_JFFS2_CLEAN_MARKERS:-0}"
 
+	# Reuse the index nand_verify_tar_file() built for this file in the
+	# same shell, if any
+	local tar_index
+	[ "$NAND_TAR_INDEX_FILE" = "$tar_file" ] && tar_index="$NAND_TAR_INDEX"
+	[ -n "$tar_index" ] || tar_index="$(nand_tar_index "$tar_file" "$cmd")" || return 1
+
 	# WARNING: This fails if tar contains more than one 'sysupgrade-*' directory.
-	local board_dir="$($cmd < "$tar_file" | tar tf - | grep -m 1 '^sysupgrade-.*/$')"
-	board_dir="${board_dir%/}"
+	local board_dir="$(echo "$tar_index" | awk -F/ '/^sysupgrade-[^/]*\// { print $1; exit }')"
 
 	local kernel_mtd kernel_length
 	if [ "$CI_KERNPART" != "none" ]; then
 		kernel_mtd="$(find_mtd_index "$CI_KERNPART")"
-		kernel_length=$( ($cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | wc -c) 2> /dev/null)
+		kernel_length="$(nand_tar_field "$tar_index" "$board_dir/kernel" 2)"
 		[ "$kernel_length" = 0 ] && kernel_length=
 	fi
-	local rootfs_length=$( ($cmd < "$tar_file" | tar xOf - "$board_dir/root" | wc -c) 2> /dev/null)
+	local rootfs_length="$(nand_tar_field "$tar_index" "$board_dir/root" 2)"
 	[ "$rootfs_length" = 0 ] && rootfs_length=
 	local rootfs_type
-	[ "$rootfs_length" ] && rootfs_type="$(identify_tar "$tar_file" "$cmd" "$board_dir/root")"
+	[ "$rootfs_length" ] && rootfs_type="$(identify_magic_long "$(nand_tar_field "$tar_index" "$board_dir/root" 3)")"
 
 	# If CI_SKIP_KERNEL_MTD is set, ignore any potential kernel MTD partition that was found.
 	# This is needed if there's an MTD partition with the same name as the kernel's UBI volume.
@@ -348,30 +367,42 @@ nand_upgrade_tar() {
 	local has_env=0
 	nand_upgrade_prepare_ubi "$rootfs_length" "$rootfs_type" "$ubi_kernel_length" "$has_env" || return 1
 
+	local root_writer kernel_writer
 	if [ "$rootfs_length" ]; then
 		local ubidev="$( nand_find_ubi "${CI_ROOT_UBIPART:-$CI_UBIPART}" )"
 		local root_ubivol="$( nand_find_volume $ubidev "$CI_ROOTPART" )"
-		$cmd < "$tar_file" | tar xOf - "$board_dir/root" | \
-			ubiupdatevol /dev/$root_ubivol -s "$rootfs_length" -
+		root_writer="ubiupdatevol /dev/$root_ubivol -s $rootfs_length -"
 	fi
 	if [ "$kernel_length" ]; then
 		if [ "$kernel_mtd" ]; then
 			if [ "$jffs2_markers" = 1 ]; then
 				flash_erase -j "/dev/mtd${kernel_mtd}" 0 0
-				$cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | \
-					nandwrite "/dev/mtd${kernel_mtd}" -
+				kernel_writer="nandwrite /dev/mtd${kernel_mtd} -"
 			else
-				$cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | \
-					mtd write - "$CI_KERNPART"
+				kernel_writer="mtd write - $CI_KERNPART"
 			fi
 		else
 			local ubidev="$( nand_find_ubi "${CI_KERN_UBIPART:-$CI_UBIPART}" )"
 			local kern_ubivol="$( nand_find_volume $ubidev "$CI_KERNPART" )"
-			$cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | \
-				ubiupdatevol /dev/$kern_ubivol -s "$kernel_length" -
+			kernel_writer="ubiupdatevol /dev/$kern_ubivol -s $kernel_length -"
 		fi
 	fi
 
+	# Second and last read of the archive: the index pass above sized the
+	# volumes, this one streams all images to their writers
+	local written
+	written="$($cmd < "$tar_file" | nandtar write \
+		${root_writer:+"$board_dir/root"} ${root_writer:+"$root_writer"} \
+		${kernel_writer:+"$board_dir/kernel"} ${kernel_writer:+"$kernel_writer"})" || return 1
+
+	local name md5
+	echo "$written" | while read name md5; do
+		if [ "$(nand_tar_field "$tar_index" "$name" 4)" != "$md5" ]; then
+			echo "checksum mismatch for $name"
+			exit 1
+		fi
+	done || return 1
+
 	return 0
 }
 
@@ -393,10 +424,13 @@ nand_verify_tar_file() {
 	local cmd="$2"
 
 	echo "verifying sysupgrade tar file integrity"
-	if ! $cmd < "$file" | tar xOf - > /dev/null; then
+	NAND_TAR_INDEX_FILE=
+	if ! NAND_TAR_INDEX="$(nand_tar_index "$file" "$cmd")"; then
+		NAND_TAR_INDEX=
 		echo "corrupted sysupgrade tar file"
 		return 1
 	fi
+	NAND_TAR_INDEX_FILE="$file"
 }
 
 nand_do_flash_file() {
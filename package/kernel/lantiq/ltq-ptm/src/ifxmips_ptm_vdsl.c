@@ -30,6 +30,7 @@
 #include <linux/init.h>
 #include <linux/ioctl.h>
 #include <linux/etherdevice.h>
+#include <linux/ethtool.h>
 #include <linux/interrupt.h>
 #include <linux/netdevice.h>
 #include <linux/mod_devicetable.h>
@@ -76,8 +77,12 @@ static int ptm_stop(struct net_device *);
   static unsigned int ptm_poll(int, unsigned int);
   static int ptm_napi_poll(struct napi_struct *, int);
 static int ptm_hard_start_xmit(struct sk_buff *, struct net_device *);
+static u16 ptm_select_queue(struct net_device *, struct sk_buff *, struct net_device *);
 static int ptm_ioctl(struct net_device *, struct ifreq *, void __user *, int);
 static void ptm_tx_timeout(struct net_device *, unsigned int txqueue);
+static void ptm_get_strings(struct net_device *, u32, u8 *);
+static int ptm_get_sset_count(struct net_device *, int);
+static void ptm_get_ethtool_stats(struct net_device *, struct ethtool_stats *, u64 *);
 
 static inline struct sk_buff* alloc_skb_rx(void);
 static inline struct sk_buff* alloc_skb_tx(unsigned int);
@@ -114,12 +119,20 @@ static struct net_device_ops g_ptm_netdev_ops = {
     .ndo_open            = ptm_open,
     .ndo_stop            = ptm_stop,
     .ndo_start_xmit      = ptm_hard_start_xmit,
+    .ndo_select_queue    = ptm_select_queue,
     .ndo_validate_addr   = eth_validate_addr,
     .ndo_set_mac_address = eth_mac_addr,
     .ndo_siocdevprivate  = ptm_ioctl,
     .ndo_tx_timeout      = ptm_tx_timeout,
 };
 
+static const struct ethtool_ops g_ptm_ethtool_ops = {
+    .get_link            = ethtool_op_get_link,
+    .get_strings         = ptm_get_strings,
+    .get_sset_count      = ptm_get_sset_count,
+    .get_ethtool_stats   = ptm_get_ethtool_stats,
+};
+
 static struct net_device *g_net_dev[1] = {0};
 static char *g_net_dev_name[1] = {"dsl0"};
 
@@ -144,6 +157,9 @@ static int ptm_setup(struct device_node *np, struct net_device *dev, int ndev)
     netif_carrier_off(dev);
 
     dev->netdev_ops      = &g_ptm_netdev_ops;
+    dev->ethtool_ops     = &g_ptm_ethtool_ops;
+    /* room for the skb pointer and the burst alignment in front of the data */
+    dev->needed_headroom = sizeof(struct sk_buff *) + DATA_BUFFER_ALIGNMENT;
     /* Allow up to 1508 bytes, for RFC4638 */
     dev->max_mtu         = ETH_DATA_LEN + 8;
     netif_napi_add_weight(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, 16);
@@ -184,7 +200,7 @@ static int ptm_open(struct net_device *dev)
 
     IFX_REG_W32_MASK(0, 1, MBOX_IGU1_IER);
 
-    netif_start_queue(dev);
+    netif_tx_start_all_queues(dev);
 
     return 0;
 }
@@ -197,7 +213,7 @@ static int ptm_stop(struct net_device *dev)
 
     napi_disable(&g_ptm_priv_data.itf[0].napi);
 
-    netif_stop_queue(dev);
+    netif_tx_stop_all_queues(dev);
 
     return 0;
 }
@@ -208,6 +224,7 @@ static unsigned int ptm_poll(int ndev, unsigned int work_to_do)
     volatile struct rx_descriptor *desc;
     struct rx_descriptor reg_desc;
     struct sk_buff *skb, *new_skb;
+    LIST_HEAD(rx_list);
 
     ASSERT(ndev >= 0 && ndev < ARRAY_SIZE(g_net_dev), "ndev = %d (wrong value)", ndev);
 
@@ -231,7 +248,7 @@ static unsigned int ptm_poll(int ndev, unsigned int work_to_do)
             skb->dev = g_net_dev[0];
             skb->protocol = eth_type_trans(skb, skb->dev);
 
-            netif_receive_skb(skb);
+            list_add_tail(&skb->list, &rx_list);
 
             g_ptm_priv_data.itf[0].stats.rx_packets++;
             g_ptm_priv_data.itf[0].stats.rx_bytes += reg_desc.datalen;
@@ -252,6 +269,8 @@ static unsigned int ptm_poll(int ndev, unsigned int work_to_do)
         work_done++;
     }
 
+    netif_receive_skb_list(&rx_list);
+
     return work_done;
 }
 
@@ -288,7 +307,9 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
     volatile struct tx_descriptor *desc;
     struct tx_descriptor reg_desc = {0};
     struct sk_buff *skb_to_free;
+    struct ptm_itf *p_itf = &g_ptm_priv_data.itf[0];
     unsigned int byteoff;
+    unsigned int qid;
 
     ASSERT(dev == g_net_dev[0], "incorrect device");
 
@@ -297,42 +318,44 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
         goto PTM_HARD_START_XMIT_FAIL;
     }
 
+    /*
+     *  skb pointer is stored in the headroom, which needed_headroom normally
+     *  reserves. Only expand the head if it is short, or unshare it if another
+     *  clone may write to it; clones with a released header (e.g. TCP) are sent
+     *  as is, without copying the payload
+     */
+    byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
+    if ( skb_headroom(skb) < sizeof(struct sk_buff *) + byteoff || skb_header_cloned(skb) ) {
+        if ( skb_cow_head(skb, sizeof(struct sk_buff *) + DATA_BUFFER_ALIGNMENT) ) {
+            dbg("no memory");
+            goto ALLOC_SKB_TX_FAIL;
+        }
+        byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
+    }
+
+    /* make the skb unowned */
+    skb_orphan(skb);
+
+    qid = skb_get_queue_mapping(skb);
+
+    /*  all TX queues share one descriptor ring to PP32  */
+    spin_lock(&p_itf->tx_lock);
+
     /*  allocate descriptor */
     desc_base = get_tx_desc(0, &f_full);
     if ( f_full ) {
         netif_trans_update(dev);
-        netif_stop_queue(dev);
+        netif_tx_stop_all_queues(dev);
+        p_itf->tx_ring_full++;
 
         IFX_REG_W32_MASK(0, 1 << 17, MBOX_IGU1_ISRC);
         IFX_REG_W32_MASK(0, 1 << 17, MBOX_IGU1_IER);
     }
-    if ( desc_base < 0 )
+    if ( desc_base < 0 ) {
+        spin_unlock(&p_itf->tx_lock);
         goto PTM_HARD_START_XMIT_FAIL;
-    desc = &CPU_TO_WAN_TX_DESC_BASE[desc_base];
-
-    byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
-    if ( skb_headroom(skb) < sizeof(struct sk_buff *) + byteoff || skb_cloned(skb) ) {
-        struct sk_buff *new_skb;
-
-        ASSERT(skb_headroom(skb) >= sizeof(struct sk_buff *) + byteoff, "skb_headroom(skb) < sizeof(struct sk_buff *) + byteoff");
-        ASSERT(!skb_cloned(skb), "skb is cloned");
-
-        new_skb = alloc_skb_tx(skb->len);
-        if ( new_skb == NULL ) {
-            dbg("no memory");
-            goto ALLOC_SKB_TX_FAIL;
-        }
-        skb_put(new_skb, skb->len);
-        memcpy(new_skb->data, skb->data, skb->len);
-        dev_kfree_skb_any(skb);
-        skb = new_skb;
-        byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
-        /*  write back to physical memory   */
-        dma_cache_wback((unsigned long)skb->data, skb->len);
     }
-
-    /* make the skb unowned */
-    skb_orphan(skb);
+    desc = &CPU_TO_WAN_TX_DESC_BASE[desc_base];
 
     *(struct sk_buff **)((unsigned int)skb->data - byteoff - sizeof(struct sk_buff *)) = skb;
     /*  write back to physical memory   */
@@ -347,21 +370,25 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
     reg_desc.small   = 0;
     reg_desc.dataptr = (unsigned int)skb->data & (0x0FFFFFFF ^ (DATA_BUFFER_ALIGNMENT - 1));
     reg_desc.datalen = skb->len < ETH_ZLEN ? ETH_ZLEN : skb->len;
-    reg_desc.qid     = g_ptm_prio_queue_map[skb->priority > 7 ? 7 : skb->priority];
+    reg_desc.qid     = qid;
     reg_desc.byteoff = byteoff;
     reg_desc.own     = 1;
     reg_desc.c       = 1;
     reg_desc.sop = reg_desc.eop = 1;
 
     /*  update MIB  */
-    g_ptm_priv_data.itf[0].stats.tx_packets++;
-    g_ptm_priv_data.itf[0].stats.tx_bytes += reg_desc.datalen;
+    p_itf->stats.tx_packets++;
+    p_itf->stats.tx_bytes += reg_desc.datalen;
+    p_itf->tx_queue_packets[qid]++;
+    p_itf->tx_queue_bytes[qid] += reg_desc.datalen;
 
     /*  write discriptor to memory  */
     *((volatile unsigned int *)desc + 1) = *((unsigned int *)&reg_desc + 1);
     wmb();
     *(volatile unsigned int *)desc = *(unsigned int *)&reg_desc;
 
+    spin_unlock(&p_itf->tx_lock);
+
     netif_trans_update(dev);
 
     return 0;
@@ -373,6 +400,15 @@ PTM_HARD_START_XMIT_FAIL:
     return 0;
 }
 
+static u16 ptm_select_queue(struct net_device *dev, struct sk_buff *skb, struct net_device *sb_dev)
+{
+    /*  TX queue n is PPE QoS queue n, use traffic class mapping if set up (e.g. mqprio)  */
+    if ( netdev_get_num_tc(dev) )
+        return netdev_pick_tx(dev, skb, sb_dev);
+
+    return g_ptm_prio_queue_map[skb->priority > 7 ? 7 : skb->priority];
+}
+
 static int ptm_ioctl(struct net_device *dev, struct ifreq *ifr, void __user *data, int cmd)
 {
     ASSERT(dev == g_net_dev[0], "incorrect device");
@@ -491,12 +527,59 @@ static void ptm_tx_timeout(struct net_device *dev, unsigned int txqueue)
     /*  disable TX irq, release skb when sending new packet */
     IFX_REG_W32_MASK(1 << 17, 0, MBOX_IGU1_IER);
 
-    /*  wake up TX queue    */
-    netif_wake_queue(dev);
+    /*  wake up TX queues   */
+    netif_tx_wake_all_queues(dev);
 
     return;
 }
 
+static const char g_ptm_queue_stat_names[][ETH_GSTRING_LEN] = {
+    "packets",
+    "bytes",
+    "fw_packets",
+    "fw_bytes",
+    "fw_dropped",
+};
+
+static void ptm_get_strings(struct net_device *dev, u32 stringset, u8 *data)
+{
+    int i, j;
+
+    if ( stringset != ETH_SS_STATS )
+        return;
+
+    ethtool_puts(&data, "tx_ring_full");
+    for ( i = 0; i < dev->real_num_tx_queues; i++ )
+        for ( j = 0; j < ARRAY_SIZE(g_ptm_queue_stat_names); j++ )
+            ethtool_sprintf(&data, "txq%d_%s", i, g_ptm_queue_stat_names[j]);
+}
+
+static int ptm_get_sset_count(struct net_device *dev, int sset)
+{
+    if ( sset != ETH_SS_STATS )
+        return -EOPNOTSUPP;
+
+    return 1 + dev->real_num_tx_queues * ARRAY_SIZE(g_ptm_queue_stat_names);
+}
+
+static void ptm_get_ethtool_stats(struct net_device *dev, struct ethtool_stats *stats, u64 *data)
+{
+    struct ptm_itf *p_itf = &g_ptm_priv_data.itf[0];
+    volatile struct wan_tx_mib_table *mib;
+    int i;
+
+    *data++ = p_itf->tx_ring_full;
+    for ( i = 0; i < dev->real_num_tx_queues; i++ ) {
+        mib = WAN_TX_MIB_TABLE(i);
+
+        *data++ = p_itf->tx_queue_packets[i];
+        *data++ = p_itf->tx_queue_bytes[i];
+        *data++ = mib->wtx_total_pdu;
+        *data++ = mib->wtx_total_bytes;
+        *data++ = mib->wtx_cpu_dropdes_pdu + mib->wtx_fast_dropdes_pdu;
+    }
+}
+
 static inline struct sk_buff* alloc_skb_rx(void)
 {
     struct sk_buff *skb;
@@ -602,7 +685,7 @@ static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
             }
 	    if (isr & BIT(17)) {
                 IFX_REG_W32_MASK(1 << 17, 0, MBOX_IGU1_IER);
-                netif_wake_queue(g_net_dev[0]);
+                netif_tx_wake_all_queues(g_net_dev[0]);
         	}
 
     return IRQ_HANDLED;
@@ -682,6 +765,7 @@ static inline int init_priv_data(void)
     }
 
     memset(&g_ptm_priv_data, 0, sizeof(g_ptm_priv_data));
+    spin_lock_init(&g_ptm_priv_data.itf[0].tx_lock);
 
     {
         int max_packet_priority = ARRAY_SIZE(g_ptm_prio_queue_map);
@@ -1018,7 +1102,7 @@ static int ltq_ptm_probe(struct platform_device *pdev)
     }
 
     for ( i = 0; i < ARRAY_SIZE(g_net_dev); i++ ) {
-        g_net_dev[i] = alloc_netdev(0, g_net_dev_name[i], NET_NAME_UNKNOWN, ether_setup);
+        g_net_dev[i] = alloc_netdev_mqs(0, g_net_dev_name[i], NET_NAME_UNKNOWN, ether_setup, __ETH_WAN_TX_QUEUE_NUM, 1);
         if ( g_net_dev[i] == NULL )
             goto ALLOC_NETDEV_FAIL;
         ret = ptm_setup(np, g_net_dev[i], i);
@@ -91,6 +91,12 @@ struct ptm_itf {
 
     struct net_device_stats         stats;
 
+    unsigned long                   tx_queue_packets[8];
+    unsigned long                   tx_queue_bytes[8];
+    unsigned long                   tx_ring_full;
+
+    spinlock_t                      tx_lock;
+
     struct napi_struct              napi;
 };
 
@@ -1523,6 +1523,17 @@ let main_obj = {
 			return 0;
 		}
 	},
+	pmk_cache: {
+		args: {
+			flush: true,
+		},
+		call: function(req) {
+			if (req.args.flush)
+				hostapd.pmk_cache_flush();
+
+			return hostapd.pmk_cache_stats();
+		}
+	},
 };
 
 hostapd.data.ubus = ubus;
@@ -40,6 +40,21 @@ struct ubus_banned_client {
 	u8 addr[ETH_ALEN];
 };
 
+static int avl_compare_macaddr(const void *k1, const void *k2, void *ptr)
+{
+	return memcmp(k1, k2, ETH_ALEN);
+}
+
+static void
+blobmsg_add_macaddr(struct blob_buf *buf, const char *name, const u8 *addr)
+{
+	char *s;
+
+	s = blobmsg_alloc_string_buffer(buf, name, 20);
+	sprintf(s, MACSTR, MAC2STR(addr));
+	blobmsg_add_string_buffer(buf);
+}
+
 static void ubus_reconnect_timeout(void *eloop_data, void *user_ctx)
 {
 	if (ubus_reconnect(ctx, NULL)) {
@@ -157,6 +172,188 @@ hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
 	eloop_register_timeout(0, time * 1000, hostapd_bss_del_ban, ban, hapd);
 }
 
+struct ubus_verdict {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	struct {
+		int status;
+		u64 expire;
+	} type[HOSTAPD_UBUS_TYPE_MAX];
+};
+
+static u64 hostapd_ubus_time_ms(void)
+{
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+
+	return now.sec * 1000ULL + now.usec / 1000;
+}
+
+static void
+hostapd_bss_verdict_gc(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+	struct ubus_verdict *v, *tmp;
+	u64 now = hostapd_ubus_time_ms();
+	int i;
+
+	avl_for_each_element_safe(&hapd->ubus.verdicts, v, avl, tmp) {
+		for (i = 0; i < HOSTAPD_UBUS_TYPE_MAX; i++)
+			if (v->type[i].expire > now)
+				break;
+
+		if (i < HOSTAPD_UBUS_TYPE_MAX)
+			continue;
+
+		avl_delete(&hapd->ubus.verdicts, &v->avl);
+		free(v);
+	}
+
+	if (!avl_is_empty(&hapd->ubus.verdicts))
+		eloop_register_timeout(1, 0, hostapd_bss_verdict_gc, hapd, NULL);
+}
+
+/* type < 0 sets the verdict for all request types, ttl 0 clears it */
+static void
+hostapd_bss_set_verdict(struct hostapd_data *hapd, const u8 *addr, int type,
+			int status, int ttl)
+{
+	struct ubus_verdict *v;
+	u64 expire = 0;
+	int i;
+
+	v = avl_find_element(&hapd->ubus.verdicts, addr, v, avl);
+	if (!v) {
+		if (ttl <= 0)
+			return;
+
+		v = os_zalloc(sizeof(*v));
+		if (!v)
+			return;
+
+		memcpy(v->addr, addr, sizeof(v->addr));
+		v->avl.key = v->addr;
+		avl_insert(&hapd->ubus.verdicts, &v->avl);
+	}
+
+	if (ttl > 0)
+		expire = hostapd_ubus_time_ms() + ttl;
+
+	for (i = 0; i < HOSTAPD_UBUS_TYPE_MAX; i++) {
+		if (type >= 0 && type != i)
+			continue;
+
+		v->type[i].status = status;
+		v->type[i].expire = expire;
+	}
+
+	if (!eloop_is_timeout_registered(hostapd_bss_verdict_gc, hapd, NULL))
+		eloop_register_timeout(1, 0, hostapd_bss_verdict_gc, hapd, NULL);
+}
+
+static bool
+hostapd_bss_get_verdict(struct hostapd_data *hapd, const u8 *addr, int type,
+			int *status)
+{
+	struct ubus_verdict *v;
+
+	v = avl_find_element(&hapd->ubus.verdicts, addr, v, avl);
+	if (!v || v->type[type].expire <= hostapd_ubus_time_ms())
+		return false;
+
+	*status = v->type[type].status;
+	return true;
+}
+
+static void
+hostapd_bss_free_verdicts(struct hostapd_data *hapd)
+{
+	struct ubus_verdict *v, *tmp;
+
+	eloop_cancel_timeout(hostapd_bss_verdict_gc, hapd, NULL);
+	avl_remove_all_elements(&hapd->ubus.verdicts, v, avl, tmp)
+		free(v);
+}
+
+struct ubus_event_req {
+	struct ubus_notify_request nreq;
+	int resp;
+};
+
+static void
+ubus_event_cb(struct ubus_notify_request *req, int idx, int ret)
+{
+	struct ubus_event_req *ureq = container_of(req, struct ubus_event_req, nreq);
+
+	ureq->resp = ret;
+}
+
+/* pending asynchronous notification waiting for a subscriber verdict */
+struct ubus_verdict_req {
+	struct ubus_event_req ureq;
+	struct list_head list;
+	struct hostapd_data *hapd;
+	int type;
+	u8 addr[ETH_ALEN];
+};
+
+static void
+ubus_verdict_req_free(struct ubus_verdict_req *vreq);
+
+static void
+ubus_verdict_complete_cb(struct ubus_notify_request *req, int idx, int ret)
+{
+	struct ubus_verdict_req *vreq = container_of(req, struct ubus_verdict_req, ureq.nreq);
+	struct hostapd_data *hapd = vreq->hapd;
+
+	hostapd_bss_set_verdict(hapd, vreq->addr, vreq->type, vreq->ureq.resp,
+				hapd->ubus.verdict_ttl);
+	ubus_verdict_req_free(vreq);
+}
+
+static void
+ubus_verdict_timeout(void *eloop_data, void *user_ctx)
+{
+	struct ubus_verdict_req *vreq = eloop_data;
+	struct hostapd_data *hapd = vreq->hapd;
+
+	hapd->ubus.verdict_stats.timeout++;
+	hostapd_bss_set_verdict(hapd, vreq->addr, vreq->type,
+				hapd->ubus.default_status, hapd->ubus.verdict_ttl);
+	ubus_verdict_req_free(vreq);
+}
+
+static void
+ubus_verdict_req_free(struct ubus_verdict_req *vreq)
+{
+	eloop_cancel_timeout(ubus_verdict_timeout, vreq, NULL);
+	ubus_abort_request(ctx, &vreq->ureq.nreq.req);
+	list_del(&vreq->list);
+	free(vreq);
+}
+
+static bool
+hostapd_ubus_verdict_pending(struct hostapd_data *hapd, const u8 *addr, int type)
+{
+	struct ubus_verdict_req *vreq;
+
+	list_for_each_entry(vreq, &hapd->ubus.verdict_reqs, list)
+		if (vreq->type == type && !memcmp(vreq->addr, addr, ETH_ALEN))
+			return true;
+
+	return false;
+}
+
+static void
+hostapd_ubus_free_verdict_reqs(struct hostapd_data *hapd)
+{
+	struct ubus_verdict_req *vreq, *tmp;
+
+	list_for_each_entry_safe(vreq, tmp, &hapd->ubus.verdict_reqs, list)
+		ubus_verdict_req_free(vreq);
+}
+
 static int
 hostapd_bss_reload(struct ubus_context *ctx, struct ubus_object *obj,
 		   struct ubus_request_data *req, const char *method,
@@ -236,14 +433,170 @@ hostapd_parse_capab_blobmsg(struct sta_info *sta)
 	blobmsg_close_table(&b, v);
 }
 
+/* per-station change tracking for incremental get_clients queries */
+struct ubus_client_gen {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	u32 gen;
+	u32 flags;
+	u16 aid;
+	int vlan_id;
+	bool removed;
+};
+
+static void
+hostapd_bss_client_gen_del(struct hostapd_data *hapd, struct ubus_client_gen *cg)
+{
+	if (cg->removed)
+		hapd->ubus.client_removed--;
+	avl_delete(&hapd->ubus.clients, &cg->avl);
+	free(cg);
+}
+
+/*
+ * Compare the station list against the last known state and bump the
+ * generation of every station that was added, changed or removed since.
+ * Only a bounded number of removed entries is kept; queries for older
+ * generations get a full snapshot instead.
+ */
+static void
+hostapd_bss_update_client_gen(struct hostapd_data *hapd)
+{
+	struct ubus_client_gen *cg, *tmp;
+	struct sta_info *sta;
+	u32 seen = ++hapd->ubus.client_gen;
+
+	for (sta = hapd->sta_list; sta; sta = sta->next) {
+		cg = avl_find_element(&hapd->ubus.clients, sta->addr, cg, avl);
+		if (!cg) {
+			cg = os_zalloc(sizeof(*cg));
+			if (!cg)
+				continue;
+
+			memcpy(cg->addr, sta->addr, ETH_ALEN);
+			cg->avl.key = cg->addr;
+			avl_insert(&hapd->ubus.clients, &cg->avl);
+		} else if (!cg->removed && cg->flags == sta->flags &&
+			   cg->aid == sta->aid && cg->vlan_id == sta->vlan_id) {
+			continue;
+		}
+
+		if (cg->removed)
+			hapd->ubus.client_removed--;
+		cg->removed = false;
+		cg->flags = sta->flags;
+		cg->aid = sta->aid;
+		cg->vlan_id = sta->vlan_id;
+		cg->gen = seen;
+	}
+
+	avl_for_each_element_safe(&hapd->ubus.clients, cg, avl, tmp) {
+		if (cg->removed || ap_get_sta(hapd, cg->addr))
+			continue;
+
+		cg->removed = true;
+		cg->gen = seen;
+		hapd->ubus.client_removed++;
+	}
+
+	if (hapd->ubus.client_removed <= HOSTAPD_UBUS_CLIENTS_REMOVED_MAX)
+		return;
+
+	avl_for_each_element_safe(&hapd->ubus.clients, cg, avl, tmp)
+		if (cg->removed && cg->gen != seen)
+			hostapd_bss_client_gen_del(hapd, cg);
+
+	hapd->ubus.client_gen_min = seen - 1;
+}
+
+static void
+hostapd_bss_free_client_gen(struct hostapd_data *hapd)
+{
+	struct ubus_client_gen *cg, *tmp;
+
+	avl_remove_all_elements(&hapd->ubus.clients, cg, avl, tmp)
+		free(cg);
+}
+
+struct ubus_sta_data {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	struct hostap_sta_driver_data data;
+};
+
+static void
+hostapd_bss_sta_data_cb(void *ctx, const u8 *addr,
+			struct hostap_sta_driver_data *data)
+{
+	struct avl_tree *tree = ctx;
+	struct ubus_sta_data *sd;
+
+	sd = os_zalloc(sizeof(*sd));
+	if (!sd)
+		return;
+
+	memcpy(sd->addr, addr, ETH_ALEN);
+	sd->data = *data;
+	sd->avl.key = sd->addr;
+	if (avl_insert(tree, &sd->avl))
+		free(sd);
+}
+
+static void
+hostapd_bss_add_sta_data(struct hostap_sta_driver_data *data)
+{
+	void *r;
+
+	r = blobmsg_open_table(&b, "bytes");
+	blobmsg_add_u64(&b, "rx", data->rx_bytes);
+	blobmsg_add_u64(&b, "tx", data->tx_bytes);
+	blobmsg_close_table(&b, r);
+	r = blobmsg_open_table(&b, "airtime");
+	blobmsg_add_u64(&b, "rx", data->rx_airtime);
+	blobmsg_add_u64(&b, "tx", data->tx_airtime);
+	blobmsg_close_table(&b, r);
+	r = blobmsg_open_table(&b, "packets");
+	blobmsg_add_u32(&b, "rx", data->rx_packets);
+	blobmsg_add_u32(&b, "tx", data->tx_packets);
+	blobmsg_close_table(&b, r);
+	r = blobmsg_open_table(&b, "rate");
+	/* Rate in kbits */
+	blobmsg_add_u32(&b, "rx", data->current_rx_rate * 100);
+	blobmsg_add_u32(&b, "tx", data->current_tx_rate * 100);
+	blobmsg_close_table(&b, r);
+	blobmsg_add_u32(&b, "signal", data->signal);
+}
+
+enum {
+	GET_CLIENTS_SINCE,
+	GET_CLIENTS_STATS,
+	GET_CLIENTS_CAPABILITIES,
+	GET_CLIENTS_TAXONOMY,
+	__GET_CLIENTS_MAX
+};
+
+static const struct blobmsg_policy get_clients_policy[__GET_CLIENTS_MAX] = {
+	[GET_CLIENTS_SINCE] = { "since", BLOBMSG_TYPE_INT32 },
+	[GET_CLIENTS_STATS] = { "stats", BLOBMSG_TYPE_BOOL },
+	[GET_CLIENTS_CAPABILITIES] = { "capabilities", BLOBMSG_TYPE_BOOL },
+	[GET_CLIENTS_TAXONOMY] = { "taxonomy", BLOBMSG_TYPE_BOOL },
+};
+
 static int
 hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 			struct ubus_request_data *req, const char *method,
 			struct blob_attr *msg)
 {
 	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
+	struct blob_attr *tb[__GET_CLIENTS_MAX];
 	struct hostap_sta_driver_data sta_driver_data;
+	struct ubus_client_gen *cg;
+	struct ubus_sta_data *sd, *tmp;
+	struct avl_tree sta_data;
 	struct sta_info *sta;
+	bool stats = true, capab = true, taxonomy = true;
+	bool full = true, dump = false;
+	u32 since = 0;
 	void *list, *c;
 	char mac_buf[20];
 	static const struct {
@@ -263,13 +616,42 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 		{ "mfp", WLAN_STA_MFP },
 	};
 
+	blobmsg_parse(get_clients_policy, __GET_CLIENTS_MAX, tb, blob_data(msg), blob_len(msg));
+
+	if (tb[GET_CLIENTS_STATS])
+		stats = blobmsg_get_bool(tb[GET_CLIENTS_STATS]);
+	if (tb[GET_CLIENTS_CAPABILITIES])
+		capab = blobmsg_get_bool(tb[GET_CLIENTS_CAPABILITIES]);
+	if (tb[GET_CLIENTS_TAXONOMY])
+		taxonomy = blobmsg_get_bool(tb[GET_CLIENTS_TAXONOMY]);
+
+	hostapd_bss_update_client_gen(hapd);
+	if (tb[GET_CLIENTS_SINCE]) {
+		since = blobmsg_get_u32(tb[GET_CLIENTS_SINCE]);
+		full = since < hapd->ubus.client_gen_min ||
+		       since > hapd->ubus.client_gen;
+	}
+
+	avl_init(&sta_data, avl_compare_macaddr, false, NULL);
+	if (stats)
+		dump = !hostapd_drv_read_sta_data_all(hapd, hostapd_bss_sta_data_cb,
+						      &sta_data);
+
 	blob_buf_init(&b, 0);
 	blobmsg_add_u32(&b, "freq", hapd->iface->freq);
+	blobmsg_add_u32(&b, "generation", hapd->ubus.client_gen);
+	blobmsg_add_u8(&b, "full", full);
 	list = blobmsg_open_table(&b, "clients");
 	for (sta = hapd->sta_list; sta; sta = sta->next) {
 		void *r;
 		int i;
 
+		if (!full) {
+			cg = avl_find_element(&hapd->ubus.clients, sta->addr, cg, avl);
+			if (cg && cg->gen <= since)
+				continue;
+		}
+
 		sprintf(mac_buf, MACSTR, MAC2STR(sta->addr));
 		c = blobmsg_open_table(&b, mac_buf);
 		for (i = 0; i < ARRAY_SIZE(sta_flags); i++)
@@ -296,40 +678,43 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 
 		blobmsg_add_u32(&b, "aid", sta->aid);
 #ifdef CONFIG_TAXONOMY
-		r = blobmsg_alloc_string_buffer(&b, "signature", 1024);
-		if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
-			blobmsg_add_string_buffer(&b);
+		if (taxonomy) {
+			r = blobmsg_alloc_string_buffer(&b, "signature", 1024);
+			if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
+				blobmsg_add_string_buffer(&b);
+		}
 #endif
 
 		/* Driver information */
-		if (hostapd_drv_read_sta_data(hapd, &sta_driver_data, sta->addr) >= 0) {
-			r = blobmsg_open_table(&b, "bytes");
-			blobmsg_add_u64(&b, "rx", sta_driver_data.rx_bytes);
-			blobmsg_add_u64(&b, "tx", sta_driver_data.tx_bytes);
-			blobmsg_close_table(&b, r);
-			r = blobmsg_open_table(&b, "airtime");
-			blobmsg_add_u64(&b, "rx", sta_driver_data.rx_airtime);
-			blobmsg_add_u64(&b, "tx", sta_driver_data.tx_airtime);
-			blobmsg_close_table(&b, r);
-			r = blobmsg_open_table(&b, "packets");
-			blobmsg_add_u32(&b, "rx", sta_driver_data.rx_packets);
-			blobmsg_add_u32(&b, "tx", sta_driver_data.tx_packets);
-			blobmsg_close_table(&b, r);
-			r = blobmsg_open_table(&b, "rate");
-			/* Rate in kbits */
-			blobmsg_add_u32(&b, "rx", sta_driver_data.current_rx_rate * 100);
-			blobmsg_add_u32(&b, "tx", sta_driver_data.current_tx_rate * 100);
-			blobmsg_close_table(&b, r);
-			blobmsg_add_u32(&b, "signal", sta_driver_data.signal);
-		}
-
-		hostapd_parse_capab_blobmsg(sta);
+		sd = NULL;
+		if (dump)
+			sd = avl_find_element(&sta_data, sta->addr, sd, avl);
+		if (sd)
+			hostapd_bss_add_sta_data(&sd->data);
+		else if (stats &&
+			 hostapd_drv_read_sta_data(hapd, &sta_driver_data, sta->addr) >= 0)
+			hostapd_bss_add_sta_data(&sta_driver_data);
+
+		if (capab)
+			hostapd_parse_capab_blobmsg(sta);
 
 		blobmsg_close_table(&b, c);
 	}
 	blobmsg_close_array(&b, list);
+
+	if (!full) {
+		list = blobmsg_open_array(&b, "removed");
+		avl_for_each_element(&hapd->ubus.clients, cg, avl)
+			if (cg->removed && cg->gen > since)
+				blobmsg_add_macaddr(&b, NULL, cg->addr);
+		blobmsg_close_array(&b, list);
+	}
+
 	ubus_send_reply(ctx, req, b.head);
 
+	avl_remove_all_elements(&sta_data, sd, avl, tmp)
+		free(sd);
+
 	return 0;
 }
 
@@ -354,7 +739,7 @@ hostapd_bss_get_status(struct ubus_context *ctx, struct ubus_object *obj,
 		       struct blob_attr *msg)
 {
 	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
-	void *airtime_table, *dfs_table, *rrm_table, *wnm_table;
+	void *airtime_table, *dfs_table, *rrm_table, *wnm_table, *notify_table;
 	struct os_reltime now;
 	char ssid[SSID_MAX_LEN + 1];
 	char phy_name[17];
@@ -420,6 +805,15 @@ hostapd_bss_get_status(struct ubus_context *ctx, struct ubus_object *obj,
 			hapd->iface->cac_started ? hapd->iface->dfs_cac_ms / 1000 - now.sec : 0);
 	blobmsg_close_table(&b, dfs_table);
 
+	/* Notify verdicts */
+	notify_table = blobmsg_open_table(&b, "notify");
+	blobmsg_add_u8(&b, "async", hapd->ubus.notify_async);
+	blobmsg_add_u32(&b, "verdict_cache_entries", hapd->ubus.verdicts.count);
+	blobmsg_add_u64(&b, "verdict_cache_hit", hapd->ubus.verdict_stats.cache_hit);
+	blobmsg_add_u64(&b, "verdict_cache_miss", hapd->ubus.verdict_stats.cache_miss);
+	blobmsg_add_u64(&b, "verdict_timeout", hapd->ubus.verdict_stats.timeout);
+	blobmsg_close_table(&b, notify_table);
+
 	ubus_send_reply(ctx, req, b.head);
 
 	return 0;
@@ -427,11 +821,19 @@ hostapd_bss_get_status(struct ubus_context *ctx, struct ubus_object *obj,
 
 enum {
 	NOTIFY_RESPONSE,
+	NOTIFY_ASYNC,
+	NOTIFY_TIMEOUT,
+	NOTIFY_VERDICT_TTL,
+	NOTIFY_DEFAULT_STATUS,
 	__NOTIFY_MAX
 };
 
 static const struct blobmsg_policy notify_policy[__NOTIFY_MAX] = {
 	[NOTIFY_RESPONSE] = { "notify_response", BLOBMSG_TYPE_INT32 },
+	[NOTIFY_ASYNC] = { "async", BLOBMSG_TYPE_BOOL },
+	[NOTIFY_TIMEOUT] = { "timeout", BLOBMSG_TYPE_INT32 },
+	[NOTIFY_VERDICT_TTL] = { "verdict_ttl", BLOBMSG_TYPE_INT32 },
+	[NOTIFY_DEFAULT_STATUS] = { "default_status", BLOBMSG_TYPE_INT32 },
 };
 
 static int
@@ -452,6 +854,82 @@ hostapd_notify_response(struct ubus_context *ctx, struct ubus_object *obj,
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
 	hapd->ubus.notify_response = blobmsg_get_u32(tb[NOTIFY_RESPONSE]);
+	hapd->ubus.notify_async = tb[NOTIFY_ASYNC] && blobmsg_get_bool(tb[NOTIFY_ASYNC]);
+
+	hapd->ubus.notify_timeout = HOSTAPD_UBUS_NOTIFY_TIMEOUT;
+	if (tb[NOTIFY_TIMEOUT])
+		hapd->ubus.notify_timeout = blobmsg_get_u32(tb[NOTIFY_TIMEOUT]);
+
+	hapd->ubus.verdict_ttl = HOSTAPD_UBUS_VERDICT_TTL;
+	if (tb[NOTIFY_VERDICT_TTL])
+		hapd->ubus.verdict_ttl = blobmsg_get_u32(tb[NOTIFY_VERDICT_TTL]);
+
+	hapd->ubus.default_status = WLAN_STATUS_SUCCESS;
+	if (tb[NOTIFY_DEFAULT_STATUS])
+		hapd->ubus.default_status = blobmsg_get_u32(tb[NOTIFY_DEFAULT_STATUS]);
+
+	return UBUS_STATUS_OK;
+}
+
+enum {
+	VERDICT_ADDR,
+	VERDICT_TYPE,
+	VERDICT_STATUS,
+	VERDICT_TTL,
+	__VERDICT_MAX
+};
+
+static const struct blobmsg_policy verdict_policy[__VERDICT_MAX] = {
+	[VERDICT_ADDR] = { "addr", BLOBMSG_TYPE_STRING },
+	[VERDICT_TYPE] = { "type", BLOBMSG_TYPE_STRING },
+	[VERDICT_STATUS] = { "status", BLOBMSG_TYPE_INT32 },
+	[VERDICT_TTL] = { "ttl", BLOBMSG_TYPE_INT32 },
+};
+
+static const char * const hostapd_ubus_event_types[HOSTAPD_UBUS_TYPE_MAX] = {
+	[HOSTAPD_UBUS_PROBE_REQ] = "probe",
+	[HOSTAPD_UBUS_AUTH_REQ] = "auth",
+	[HOSTAPD_UBUS_ASSOC_REQ] = "assoc",
+};
+
+static int
+hostapd_bss_set_verdict_cb(struct ubus_context *ctx, struct ubus_object *obj,
+			   struct ubus_request_data *req, const char *method,
+			   struct blob_attr *msg)
+{
+	struct blob_attr *tb[__VERDICT_MAX];
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	int ttl = hapd->ubus.verdict_ttl;
+	int status = WLAN_STATUS_SUCCESS;
+	int type = -1;
+	u8 addr[ETH_ALEN];
+
+	blobmsg_parse(verdict_policy, __VERDICT_MAX, tb, blob_data(msg), blob_len(msg));
+
+	if (!tb[VERDICT_ADDR])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	if (hwaddr_aton(blobmsg_data(tb[VERDICT_ADDR]), addr))
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	if (tb[VERDICT_TYPE]) {
+		const char *name = blobmsg_get_string(tb[VERDICT_TYPE]);
+
+		for (type = 0; type < HOSTAPD_UBUS_TYPE_MAX; type++)
+			if (!strcmp(name, hostapd_ubus_event_types[type]))
+				break;
+
+		if (type == HOSTAPD_UBUS_TYPE_MAX)
+			return UBUS_STATUS_INVALID_ARGUMENT;
+	}
+
+	if (tb[VERDICT_STATUS])
+		status = blobmsg_get_u32(tb[VERDICT_STATUS]);
+
+	if (tb[VERDICT_TTL])
+		ttl = blobmsg_get_u32(tb[VERDICT_TTL]);
+
+	hostapd_bss_set_verdict(hapd, addr, type, status, ttl);
 
 	return UBUS_STATUS_OK;
 }
@@ -519,16 +997,6 @@ hostapd_bss_del_client(struct ubus_context *ctx, struct ubus_object *obj,
 	return 0;
 }
 
-static void
-blobmsg_add_macaddr(struct blob_buf *buf, const char *name, const u8 *addr)
-{
-	char *s;
-
-	s = blobmsg_alloc_string_buffer(buf, name, 20);
-	sprintf(s, MACSTR, MAC2STR(addr));
-	blobmsg_add_string_buffer(buf);
-}
-
 static int
 hostapd_bss_list_bans(struct ubus_context *ctx, struct ubus_object *obj,
 		      struct ubus_request_data *req, const char *method,
@@ -1646,7 +2114,7 @@ hostapd_bss_get_sta_ies(struct ubus_context *ctx, struct ubus_object *obj,
 
 static const struct ubus_method bss_methods[] = {
 	UBUS_METHOD_NOARG("reload", hostapd_bss_reload),
-	UBUS_METHOD_NOARG("get_clients", hostapd_bss_get_clients),
+	UBUS_METHOD("get_clients", hostapd_bss_get_clients, get_clients_policy),
 #ifdef CONFIG_TAXONOMY
 	UBUS_METHOD("get_sta_ies", hostapd_bss_get_sta_ies, addr_policy),
 #endif
@@ -1668,6 +2136,7 @@ static const struct ubus_method bss_methods[] = {
 #endif
 	UBUS_METHOD("set_vendor_elements", hostapd_vendor_elements, ve_policy),
 	UBUS_METHOD("notify_response", hostapd_notify_response, notify_policy),
+	UBUS_METHOD("set_verdict", hostapd_bss_set_verdict_cb, verdict_policy),
 	UBUS_METHOD("bss_mgmt_enable", hostapd_bss_mgmt_enable, bss_mgmt_enable_policy),
 	UBUS_METHOD_NOARG("rrm_nr_get_own", hostapd_rrm_nr_get_own),
 	UBUS_METHOD_NOARG("rrm_nr_list", hostapd_rrm_nr_list),
@@ -1682,11 +2151,6 @@ static const struct ubus_method bss_methods[] = {
 static struct ubus_object_type bss_object_type =
 	UBUS_OBJECT_TYPE("hostapd_bss", bss_methods);
 
-static int avl_compare_macaddr(const void *k1, const void *k2, void *ptr)
-{
-	return memcmp(k1, k2, ETH_ALEN);
-}
-
 static int
 hostapd_wired_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 			  struct ubus_request_data *req, const char *method,
@@ -1780,6 +2244,12 @@ void hostapd_ubus_add_bss(struct hostapd_data *hapd)
 	if (!hostapd_ubus_init())
 		return;
 
+	avl_init(&hapd->ubus.verdicts, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.clients, avl_compare_macaddr, false, NULL);
+	INIT_LIST_HEAD(&hapd->ubus.verdict_reqs);
+	hapd->ubus.notify_timeout = HOSTAPD_UBUS_NOTIFY_TIMEOUT;
+	hapd->ubus.verdict_ttl = HOSTAPD_UBUS_VERDICT_TTL;
+
 	if (asprintf(&name, "hostapd.%s", hapd->conf->iface) < 0)
 		return;
 
@@ -1811,6 +2281,13 @@ void hostapd_ubus_free_bss(struct hostapd_data *hapd)
 	if (!ctx)
 		return;
 
+	/* only set up once hostapd_ubus_add_bss() ran for this BSS */
+	if (name) {
+		hostapd_ubus_free_verdict_reqs(hapd);
+		hostapd_bss_free_verdicts(hapd);
+		hostapd_bss_free_client_gen(hapd);
+	}
+
 	if (obj->id) {
 		ubus_remove_object(ctx, obj);
 		hostapd_ubus_ref_dec();
@@ -1857,51 +2334,10 @@ void hostapd_ubus_remove_vlan(struct hostapd_data *hapd, struct hostapd_vlan *vl
 	hostapd_ubus_vlan_action(hapd, vlan, "vlan_remove");
 }
 
-struct ubus_event_req {
-	struct ubus_notify_request nreq;
-	int resp;
-};
-
 static void
-ubus_event_cb(struct ubus_notify_request *req, int idx, int ret)
-{
-	struct ubus_event_req *ureq = container_of(req, struct ubus_event_req, nreq);
-
-	ureq->resp = ret;
-}
-
-int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_request *req)
+hostapd_ubus_event_msg(struct hostapd_data *hapd, struct hostapd_ubus_request *req,
+		       const u8 *addr)
 {
-	struct ubus_banned_client *ban;
-	const u8 bcast[ETH_ALEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
-	const char *types[HOSTAPD_UBUS_TYPE_MAX] = {
-		[HOSTAPD_UBUS_PROBE_REQ] = "probe",
-		[HOSTAPD_UBUS_AUTH_REQ] = "auth",
-		[HOSTAPD_UBUS_ASSOC_REQ] = "assoc",
-	};
-	const char *type = "mgmt";
-	struct ubus_event_req ureq = {};
-	const u8 *addr;
-
-	if (req->mgmt_frame)
-		addr = req->mgmt_frame->sa;
-	else
-		addr = req->addr;
-
-	ban = avl_find_element(&hapd->ubus.banned, addr, ban, avl);
-	if (ban)
-		return WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA;
-
-	ban = avl_find_element(&hapd->ubus.banned, bcast, ban, avl);
-	if (ban)
-		return WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA;
-
-	if (!hapd->ubus.obj.has_subscribers)
-		return WLAN_STATUS_SUCCESS;
-
-	if (req->type < ARRAY_SIZE(types))
-		type = types[req->type];
-
 	blob_buf_init(&b, 0);
 	blobmsg_add_macaddr(&b, "address", addr);
 	blobmsg_add_string(&b, "ifname", hapd->conf->iface);
@@ -1951,6 +2387,84 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 			blobmsg_close_table(&b, vht_cap);
 		}
 	}
+}
+
+/*
+ * Answer from the verdict cache without waiting for subscribers. On a miss,
+ * the subscribers are asked asynchronously and their answer is cached for
+ * the next frame from the same station, while this one gets the default.
+ */
+static int
+hostapd_ubus_handle_event_async(struct hostapd_data *hapd, struct hostapd_ubus_request *req,
+				const u8 *addr, const char *type)
+{
+	struct ubus_verdict_req *vreq;
+	int status;
+
+	if (hostapd_bss_get_verdict(hapd, addr, req->type, &status)) {
+		hapd->ubus.verdict_stats.cache_hit++;
+		return status;
+	}
+
+	hapd->ubus.verdict_stats.cache_miss++;
+	if (hostapd_ubus_verdict_pending(hapd, addr, req->type))
+		return hapd->ubus.default_status;
+
+	vreq = os_zalloc(sizeof(*vreq));
+	if (!vreq)
+		return hapd->ubus.default_status;
+
+	hostapd_ubus_event_msg(hapd, req, addr);
+	if (ubus_notify_async(ctx, &hapd->ubus.obj, type, b.head, &vreq->ureq.nreq)) {
+		free(vreq);
+		return hapd->ubus.default_status;
+	}
+
+	vreq->hapd = hapd;
+	vreq->type = req->type;
+	memcpy(vreq->addr, addr, ETH_ALEN);
+	vreq->ureq.nreq.status_cb = ubus_event_cb;
+	vreq->ureq.nreq.complete_cb = ubus_verdict_complete_cb;
+	list_add_tail(&vreq->list, &hapd->ubus.verdict_reqs);
+	ubus_complete_request_async(ctx, &vreq->ureq.nreq.req);
+	eloop_register_timeout(0, hapd->ubus.notify_timeout * 1000,
+			       ubus_verdict_timeout, vreq, NULL);
+
+	return hapd->ubus.default_status;
+}
+
+int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_request *req)
+{
+	struct ubus_banned_client *ban;
+	const u8 bcast[ETH_ALEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	const char *type = "mgmt";
+	struct ubus_event_req ureq = {};
+	const u8 *addr;
+
+	if (req->mgmt_frame)
+		addr = req->mgmt_frame->sa;
+	else
+		addr = req->addr;
+
+	ban = avl_find_element(&hapd->ubus.banned, addr, ban, avl);
+	if (ban)
+		return WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA;
+
+	ban = avl_find_element(&hapd->ubus.banned, bcast, ban, avl);
+	if (ban)
+		return WLAN_STATUS_AP_UNABLE_TO_HANDLE_NEW_STA;
+
+	if (!hapd->ubus.obj.has_subscribers)
+		return WLAN_STATUS_SUCCESS;
+
+	if (req->type < ARRAY_SIZE(hostapd_ubus_event_types))
+		type = hostapd_ubus_event_types[req->type];
+
+	if (hapd->ubus.notify_response && hapd->ubus.notify_async &&
+	    req->type < HOSTAPD_UBUS_TYPE_MAX)
+		return hostapd_ubus_handle_event_async(hapd, req, addr, type);
+
+	hostapd_ubus_event_msg(hapd, req, addr);
 
 	if (!hapd->ubus.notify_response) {
 		ubus_notify(ctx, &hapd->ubus.obj, type, b.head, -1);
@@ -1961,7 +2475,7 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 		return WLAN_STATUS_SUCCESS;
 
 	ureq.nreq.status_cb = ubus_event_cb;
-	ubus_complete_request(ctx, &ureq.nreq.req, 100);
+	ubus_complete_request(ctx, &ureq.nreq.req, hapd->ubus.notify_timeout);
 
 	if (ureq.resp)
 		return ureq.resp;
@@ -8,6 +8,10 @@
 #ifndef __HOSTAPD_UBUS_H
 #define __HOSTAPD_UBUS_H
 
+#define HOSTAPD_UBUS_NOTIFY_TIMEOUT	100 /* ms */
+#define HOSTAPD_UBUS_VERDICT_TTL	10000 /* ms */
+#define HOSTAPD_UBUS_CLIENTS_REMOVED_MAX	256
+
 enum hostapd_ubus_event_type {
 	HOSTAPD_UBUS_PROBE_REQ,
 	HOSTAPD_UBUS_AUTH_REQ,
@@ -37,7 +41,22 @@ struct sta_info;
 struct hostapd_ubus_bss {
 	struct ubus_object obj;
 	struct avl_tree banned;
+	struct avl_tree verdicts;
+	struct avl_tree clients;
+	u32 client_gen;
+	u32 client_gen_min;
+	int client_removed;
+	struct list_head verdict_reqs;
 	int notify_response;
+	bool notify_async;
+	int notify_timeout;
+	int verdict_ttl;
+	int default_status;
+	struct {
+		u64 cache_hit;
+		u64 cache_miss;
+		u64 timeout;
+	} verdict_stats;
 };
 
 void hostapd_ubus_add_iface(struct hostapd_iface *iface);
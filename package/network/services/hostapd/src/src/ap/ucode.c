@@ -4,6 +4,7 @@
 #include "utils/common.h"
 #include "utils/ucode.h"
 #include "utils/base64.h"
+#include "crypto/sha1.h"
 #include "sta_info.h"
 #include "beacon.h"
 #include "hw_features.h"
@@ -18,12 +19,37 @@
 #include "common/wpa_ctrl.h"
 #endif /* CONFIG_DPP */
 #include <libubox/uloop.h>
+#include <libubox/avl.h>
+#include <libubox/list.h>
+
+#define HOSTAPD_PMK_CACHE_SIZE	256
 
 static uc_resource_type_t *global_type, *bss_type, *iface_type;
 static struct hapd_interfaces *interfaces;
 static uc_value_t *global, *bss_registry, *iface_registry;
 static uc_vm_t *vm;
 
+struct hostapd_pmk_cache_key {
+	u8 ssid[SSID_MAX_LEN];
+	size_t ssid_len;
+	char passphrase[MAX_PASSPHRASE_LEN + 1];
+};
+
+struct hostapd_pmk_cache_entry {
+	struct avl_node avl;
+	struct list_head list;
+	struct hostapd_pmk_cache_key key;
+	u8 pmk[PMK_LEN];
+};
+
+static struct avl_tree pmk_cache;
+static LIST_HEAD(pmk_cache_lru);
+static struct {
+	u64 hit;
+	u64 miss;
+	u64 flush;
+} pmk_cache_stats;
+
 static uc_value_t *
 hostapd_ucode_bss_get_uval(struct hostapd_data *hapd)
 {
@@ -809,12 +835,110 @@ out:
 	return ret ? NULL : ucv_boolean_new(true);
 }
 
+static int
+hostapd_pmk_cache_cmp(const void *k1, const void *k2, void *ptr)
+{
+	return memcmp(k1, k2, sizeof(struct hostapd_pmk_cache_key));
+}
+
+static void
+hostapd_pmk_cache_flush(void)
+{
+	struct hostapd_pmk_cache_entry *e, *tmp;
+
+	list_for_each_entry_safe(e, tmp, &pmk_cache_lru, list) {
+		avl_delete(&pmk_cache, &e->avl);
+		list_del(&e->list);
+		bin_clear_free(e, sizeof(*e));
+	}
+	pmk_cache_stats.flush++;
+}
+
+/*
+ * PBKDF2 over a passphrase costs 4096 SHA1 iterations, so keep the derived
+ * PMK per (SSID, passphrase) instead of deriving it on every handshake.
+ */
+static int
+hostapd_pmk_cache_get(struct hostapd_data *hapd, const char *passphrase, u8 *pmk)
+{
+	struct hostapd_ssid *ssid = &hapd->conf->ssid;
+	struct hostapd_pmk_cache_key key;
+	struct hostapd_pmk_cache_entry *e;
+
+	os_memset(&key, 0, sizeof(key));
+	memcpy(key.ssid, ssid->ssid, ssid->ssid_len);
+	key.ssid_len = ssid->ssid_len;
+	os_strlcpy(key.passphrase, passphrase, sizeof(key.passphrase));
+
+	e = avl_find_element(&pmk_cache, &key, e, avl);
+	if (e) {
+		pmk_cache_stats.hit++;
+		list_move(&e->list, &pmk_cache_lru);
+		memcpy(pmk, e->pmk, PMK_LEN);
+		goto out;
+	}
+
+	pmk_cache_stats.miss++;
+	if (pbkdf2_sha1(passphrase, ssid->ssid, ssid->ssid_len, 4096,
+			pmk, PMK_LEN)) {
+		forced_memzero(&key, sizeof(key));
+		return -1;
+	}
+
+	if (pmk_cache.count >= HOSTAPD_PMK_CACHE_SIZE) {
+		e = list_last_entry(&pmk_cache_lru, struct hostapd_pmk_cache_entry, list);
+		avl_delete(&pmk_cache, &e->avl);
+		list_del(&e->list);
+	} else {
+		e = os_zalloc(sizeof(*e));
+		if (!e)
+			goto out;
+	}
+
+	e->key = key;
+	e->avl.key = &e->key;
+	memcpy(e->pmk, pmk, PMK_LEN);
+	avl_insert(&pmk_cache, &e->avl);
+	list_add(&e->list, &pmk_cache_lru);
+
+out:
+	forced_memzero(&key, sizeof(key));
+	return 0;
+}
+
+static uc_value_t *
+uc_hostapd_pmk_cache_flush(uc_vm_t *vm, size_t nargs)
+{
+	hostapd_pmk_cache_flush();
+
+	return ucv_boolean_new(true);
+}
+
+static uc_value_t *
+uc_hostapd_pmk_cache_stats(uc_vm_t *vm, size_t nargs)
+{
+	uc_value_t *ret = ucv_object_new(vm);
+
+	ucv_object_add(ret, "entries", ucv_int64_new(pmk_cache.count));
+	ucv_object_add(ret, "hit", ucv_int64_new(pmk_cache_stats.hit));
+	ucv_object_add(ret, "miss", ucv_int64_new(pmk_cache_stats.miss));
+	ucv_object_add(ret, "flush", ucv_int64_new(pmk_cache_stats.flush));
+
+	return ret;
+}
+
 int hostapd_ucode_sta_auth(struct hostapd_data *hapd, struct sta_info *sta)
 {
 	char addr[sizeof(MACSTR)];
 	uc_value_t *val, *cur;
 	int ret = 0;
 
+	/*
+	 * sta->psk may have been replaced since the last call (e.g. from
+	 * RADIUS), only trust the PMKs of a list built below.
+	 */
+	sta->psk_pmk_valid = 0;
+
 	if (wpa_ucode_call_prepare("sta_auth"))
 		return 0;
 
@@ -841,17 +965,29 @@ int hostapd_ucode_sta_auth(struct hostapd_data *hapd, struct sta_info *sta)
 
 			cur_psk = ucv_array_get(cur, i);
 			str = ucv_string_get(cur_psk);
+			if (!str)
+				continue;
+
 			str_len = strlen(str);
-			if (!str || str_len < 8 || str_len > 64)
+			if (str_len < 8 || str_len > 64)
 				continue;
 
 			p = os_zalloc(sizeof(*p));
-			if (len == 64) {
+			if (!p)
+				break;
+
+			if (str_len == 64) {
 				if (hexstr2bin(str, p->psk, PMK_LEN) < 0) {
 					free(p);
 					continue;
 				}
 			} else {
+				if (hostapd_pmk_cache_get(hapd, str, p->psk) < 0) {
+					free(p);
+					continue;
+				}
+
+				/* keep the passphrase for SAE */
 				p->is_passphrase = 1;
 				memcpy(p->passphrase, str, str_len + 1);
 			}
@@ -859,6 +995,8 @@ int hostapd_ucode_sta_auth(struct hostapd_data *hapd, struct sta_info *sta)
 			*next = p;
 			next = &p->next;
 		}
+
+		sta->psk_pmk_valid = 1;
 	}
 
 	cur = ucv_object_get(val, "force_psk", NULL);
@@ -1195,6 +1333,8 @@ int hostapd_ucode_init(struct hapd_interfaces *ifaces)
 		{ "add_iface", uc_hostapd_add_iface },
 		{ "remove_iface", uc_hostapd_remove_iface },
 		{ "udebug_set", uc_wpa_udebug_set },
+		{ "pmk_cache_flush", uc_hostapd_pmk_cache_flush },
+		{ "pmk_cache_stats", uc_hostapd_pmk_cache_stats },
 	};
 	static const uc_function_list_t bss_fns[] = {
 		{ "ctrl", uc_hostapd_bss_ctrl },
@@ -1229,6 +1369,7 @@ int hostapd_ucode_init(struct hapd_interfaces *ifaces)
 	iface_registry = ucv_array_new(vm);
 	uc_vm_registry_set(vm, "hostap.iface_registry", iface_registry);
 
+	avl_init(&pmk_cache, hostapd_pmk_cache_cmp, false, NULL);
 	global = wpa_ucode_global_init("hostapd", global_type);
 
 	if (wpa_ucode_run(HOSTAPD_UC_PATH "hostapd.uc"))
@@ -1246,6 +1387,7 @@ void hostapd_ucode_free(void)
 	if (wpa_ucode_call_prepare("shutdown") == 0)
 		ucv_put(wpa_ucode_call(0));
 	wpa_ucode_free_vm();
+	hostapd_pmk_cache_flush();
 }
 
 void hostapd_ucode_free_iface(struct hostapd_iface *iface)
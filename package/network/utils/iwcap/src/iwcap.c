@@ -26,15 +26,18 @@
 #include <signal.h>
 #include <syslog.h>
 #include <errno.h>
+#include <poll.h>
 #include <byteswap.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 
 #define ARPHRD_IEEE80211_RADIOTAP	803
 
@@ -45,6 +48,11 @@
 #define FRAMETYPE_BEACON			0x80
 #define FRAMETYPE_DATA				0x08
 
+#define RX_RING_BLOCK_SIZE			(1 << 16)
+#define RX_RING_BLOCK_NR			16
+#define RX_RING_FRAME_SIZE			2048
+#define RX_RING_RETIRE_TOV			100	/* ms */
+
 #if __BYTE_ORDER == __BIG_ENDIAN
 #define le16(x) __bswap_16(x)
 #else
@@ -57,11 +65,21 @@ uint8_t run_daemon = 0;
 
 uint32_t frames_captured = 0;
 uint32_t frames_filtered = 0;
+uint32_t frames_dropped  = 0;
 
 int capture_sock = -1;
 const char *ifname = NULL;
 
 
+struct rxring {
+	struct iovec *blocks;    /* mapped ring blocks */
+	uint32_t nr;             /* number of blocks */
+	uint32_t cur;            /* next block to look at */
+	void *map;               /* ring memory */
+	size_t size;             /* mapped size */
+};
+
+
 struct ringbuf {
 	uint32_t len;            /* number of slots */
 	uint32_t fill;           /* last used slot */
@@ -145,6 +163,125 @@ int set_promisc(int on)
 }
 
 
+/*
+ * Attach a classic BPF program to the capture socket which drops unwanted
+ * frame types in the kernel and truncates accepted frames to snaplen.
+ * The radiotap header length is little endian, so assemble it bytewise.
+ */
+int set_filter(int filter_data, int filter_beacon, uint32_t snaplen)
+{
+	struct sock_filter code[12];
+	struct sock_fprog prog;
+	int drop, n = 0;
+
+	if (filter_data || filter_beacon)
+	{
+		drop = 8 + filter_data + filter_beacon + 1;
+
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 3);
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 8);
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_MISC | BPF_TAX, 0);
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 2);
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_OR  | BPF_X, 0);
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_MISC | BPF_TAX, 0);
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_LD  | BPF_B   | BPF_IND, 0);
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_AND | BPF_K, FRAMETYPE_MASK);
+
+		if (filter_data)
+		{
+			code[n] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				FRAMETYPE_DATA, drop - n - 1, 0);
+			n++;
+		}
+
+		if (filter_beacon)
+		{
+			code[n] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				FRAMETYPE_BEACON, drop - n - 1, 0);
+			n++;
+		}
+	}
+
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, snaplen);
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+
+	prog.len = n;
+	prog.filter = code;
+
+	return setsockopt(capture_sock, SOL_SOCKET, SO_ATTACH_FILTER,
+					  &prog, sizeof(prog));
+}
+
+/*
+ * Set up a TPACKET_V3 receive ring on the capture socket, the kernel fills
+ * whole blocks of frames which are then handed to userspace in one go.
+ */
+int rxring_init(struct rxring *rx)
+{
+	int i, ver = TPACKET_V3;
+	struct tpacket_req3 req = {
+		.tp_block_size       = RX_RING_BLOCK_SIZE,
+		.tp_block_nr         = RX_RING_BLOCK_NR,
+		.tp_frame_size       = RX_RING_FRAME_SIZE,
+		.tp_frame_nr         = RX_RING_BLOCK_SIZE * RX_RING_BLOCK_NR /
+		                       RX_RING_FRAME_SIZE,
+		.tp_retire_blk_tov   = RX_RING_RETIRE_TOV,
+		.tp_feature_req_word = 0
+	};
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_VERSION,
+				   &ver, sizeof(ver)) < 0)
+		return -1;
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_RX_RING,
+				   &req, sizeof(req)) < 0)
+		return -1;
+
+	rx->size = req.tp_block_size * req.tp_block_nr;
+	rx->map = mmap(NULL, rx->size, PROT_READ | PROT_WRITE,
+				   MAP_SHARED, capture_sock, 0);
+
+	if (rx->map == MAP_FAILED)
+		return -1;
+
+	rx->blocks = calloc(req.tp_block_nr, sizeof(*rx->blocks));
+
+	if (!rx->blocks)
+	{
+		munmap(rx->map, rx->size);
+		return -1;
+	}
+
+	for (i = 0; i < req.tp_block_nr; i++)
+	{
+		rx->blocks[i].iov_base = rx->map + (i * req.tp_block_size);
+		rx->blocks[i].iov_len  = req.tp_block_size;
+	}
+
+	rx->nr = req.tp_block_nr;
+	rx->cur = 0;
+
+	return 0;
+}
+
+void rxring_free(struct rxring *rx)
+{
+	munmap(rx->map, rx->size);
+	free(rx->blocks);
+	memset(rx, 0, sizeof(*rx));
+}
+
+void update_drop_stats(void)
+{
+	struct tpacket_stats_v3 st;
+	socklen_t len = sizeof(st);
+
+	/* the kernel resets its counters on every read */
+	if (!getsockopt(capture_sock, SOL_PACKET, PACKET_STATISTICS, &st, &len))
+		frames_dropped += st.tp_drops;
+}
+
+
 void sig_dump(int sig)
 {
 	run_dump = 1;
@@ -271,8 +408,12 @@ void msg(const char *fmt, ...)
 int main(int argc, char **argv)
 {
 	int i, n;
-	struct ringbuf *ring;
+	struct ringbuf *ring = NULL;
 	struct ringbuf_entry *e;
+	struct rxring rx;
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *ph;
+	struct pollfd pfd;
 	struct sockaddr_ll local = {
 		.sll_family   = AF_PACKET,
 		.sll_protocol = htons(ETH_P_ALL)
@@ -280,9 +421,9 @@ int main(int argc, char **argv)
 
 	radiotap_hdr_t *rhdr;
 
-	uint8_t frametype;
-	uint8_t pktbuf[0xFFFF];
-	ssize_t pktlen;
+	uint8_t *pktbuf;
+	uint32_t pktlen;
+	uint32_t usec;
 
 	FILE *o;
 
@@ -433,6 +574,20 @@ int main(int argc, char **argv)
 		return 7;
 	}
 
+	if (set_filter(filter_data, filter_beacon, streaming ? 0xFFFF : pktcap))
+	{
+		msg("Unable to attach frame filter: %s\n",
+			strerror(errno));
+		return 9;
+	}
+
+	if (rxring_init(&rx))
+	{
+		msg("Unable to set up capture ring: %s\n",
+			strerror(errno));
+		return 10;
+	}
+
 	if (!streaming)
 	{
 		if (!foreground)
@@ -516,8 +671,11 @@ int main(int argc, char **argv)
 
 				fclose(o);
 
+				update_drop_stats();
+
 				msg(" * %d frames captured\n", frames_captured);
 				msg(" * %d frames filtered\n", frames_filtered);
+				msg(" * %d frames dropped by kernel\n", frames_dropped);
 				msg(" * %d frames dumped\n", n);
 			}
 
@@ -533,50 +691,74 @@ int main(int argc, char **argv)
 			if (ring)
 				ringbuf_free(ring);
 
+			rxring_free(&rx);
+
 			return 0;
 		}
 
-		pktlen = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), 0, NULL, 0);
-		frames_captured++;
+		bd = rx.blocks[rx.cur].iov_base;
 
-		/* check received frametype, if we should filter it, rewind the ring */
-		rhdr = (radiotap_hdr_t *)pktbuf;
-
-		if (pktlen <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= pktlen)
+		if (!(bd->hdr.bh1.block_status & TP_STATUS_USER))
 		{
-			frames_filtered++;
+			pfd.fd = capture_sock;
+			pfd.events = POLLIN | POLLERR;
+			pfd.revents = 0;
+
+			poll(&pfd, 1, 1000);
 			continue;
 		}
 
-		frametype = *(uint8_t *)(pktbuf + le16(rhdr->it_len));
+		ph = (struct tpacket3_hdr *)((uint8_t *)bd +
+			bd->hdr.bh1.offset_to_first_pkt);
 
-		if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
-		    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
+		/* the whole block is handed over at once, process all its frames */
+		for (i = 0; i < bd->hdr.bh1.num_pkts; i++,
+		     ph = (struct tpacket3_hdr *)((uint8_t *)ph + ph->tp_next_offset))
 		{
-			frames_filtered++;
-			continue;
-		}
+			pktbuf = (uint8_t *)ph + ph->tp_mac;
+			pktlen = ph->tp_snaplen;
+			frames_captured++;
 
-		if (streaming)
-		{
-			if (!header_written)
+			/* frame types are already filtered by the kernel, only
+			 * discard frames with a truncated radiotap header here */
+			rhdr = (radiotap_hdr_t *)pktbuf;
+
+			if (pktlen <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= pktlen)
 			{
-				write_pcap_header(stdout);
-				header_written = 1;
+				frames_filtered++;
+				continue;
 			}
 
-			write_pcap_frame(stdout, NULL, NULL, pktlen, pktlen);
-			fwrite(pktbuf, 1, pktlen, stdout);
-			fflush(stdout);
-		}
-		else
-		{
-			e = ringbuf_add(ring);
-			e->olen = pktlen;
-			e->len = (pktlen > pktcap) ? pktcap : pktlen;
+			if (streaming)
+			{
+				if (!header_written)
+				{
+					write_pcap_header(stdout);
+					header_written = 1;
+				}
 
-			memcpy((void *)e + sizeof(*e), pktbuf, e->len);
+				usec = ph->tp_nsec / 1000;
+
+				write_pcap_frame(stdout, &ph->tp_sec, &usec, pktlen, ph->tp_len);
+				fwrite(pktbuf, 1, pktlen, stdout);
+			}
+			else
+			{
+				e = ringbuf_add(ring);
+				e->sec = ph->tp_sec;
+				e->usec = ph->tp_nsec / 1000;
+				e->olen = ph->tp_len;
+				e->len = (pktlen > pktcap) ? pktcap : pktlen;
+
+				memcpy((void *)e + sizeof(*e), pktbuf, e->len);
+			}
 		}
+
+		if (streaming)
+			fflush(stdout);
+
+		bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+		rx.cur = (rx.cur + 1) % rx.nr;
 	}
 
 	return 0;
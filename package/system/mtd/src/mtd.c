@@ -36,6 +36,7 @@
 #include <errno.h>
 #include <time.h>
 #include <string.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/param.h>
@@ -51,6 +52,7 @@
 #include <libubox/md5.h>
 
 #define MAX_ARGS 8
+#define MTD_IO_BUFSIZE		(256 * 1024)
 #define JFFS2_DEFAULT_DIR	"" /* directory name without /, empty means root dir */
 
 #define TRX_MAGIC		0x48445230	/* "HDR0" */
@@ -88,6 +90,10 @@ static enum mtd_image_format imageformat = MTD_IMAGE_FORMAT_UNKNOWN;
 static char *jffs2file = NULL, *jffs2dir = JFFS2_DEFAULT_DIR;
 static char *tpl_uboot_args_part;
 static int buflen = 0;
+static int readahead_blocks = 0;
+static int show_timing = 0;
+static int incremental = 0;
+static char *cmpbuf = NULL;
 int quiet;
 int no_erase;
 int mtdsize = 0;
@@ -362,11 +368,29 @@ mtd_erase(const char *mtd)
 
 }
 
+/*
+ * Allocate a page aligned buffer for bulk flash reads, sized to a whole
+ * number of erase blocks so that bad block checks stay block aligned.
+ */
+static char *
+mtd_iobuf_alloc(int *len)
+{
+	void *ptr;
+	int size;
+
+	size = MAX(erasesize, MTD_IO_BUFSIZE - MTD_IO_BUFSIZE % erasesize);
+	if (posix_memalign(&ptr, getpagesize(), size))
+		return NULL;
+
+	*len = size;
+	return ptr;
+}
+
 static int
 mtd_dump(const char *mtd, int part_offset, int size)
 {
 	int ret = 0, offset = 0;
-	int fd;
+	int fd, i, bufsize;
 	char *buf = NULL;
 
 	if (quiet < 2)
@@ -384,14 +408,14 @@ mtd_dump(const char *mtd, int part_offset, int size)
 	if (part_offset)
 		lseek(fd, part_offset, SEEK_SET);
 
-	buf = malloc(erasesize);
+	buf = mtd_iobuf_alloc(&bufsize);
 	if (!buf) {
 		ret = -1;
 		goto out;
 	}
 
 	do {
-		int len = (size > erasesize) ? (erasesize) : (size);
+		int len = (size > bufsize) ? (bufsize) : (size);
 		int rlen = read(fd, buf, len);
 
 		if (rlen < 0) {
@@ -400,15 +424,24 @@ mtd_dump(const char *mtd, int part_offset, int size)
 			ret = -1;
 			goto out;
 		}
-		if (!rlen || rlen != len)
+		if (!rlen)
 			break;
-		if (mtd_block_is_bad(fd, offset)) {
-			fprintf(stderr, "skipping bad block at 0x%08x\n", offset);
-		} else {
-			size -= rlen;
-			write(1, buf, rlen);
+
+		for (i = 0; i < rlen && size > 0; i += erasesize) {
+			int blen = MIN(erasesize, rlen - i);
+
+			if (mtd_block_is_bad(fd, offset)) {
+				fprintf(stderr, "skipping bad block at 0x%08x\n", offset);
+			} else {
+				blen = MIN(blen, size);
+				size -= blen;
+				write(1, buf + i, blen);
+			}
+			offset += erasesize;
 		}
-		offset += rlen;
+
+		if (rlen != len)
+			break;
 	} while (size > 0);
 
 out:
@@ -424,7 +457,8 @@ mtd_verify(const char *mtd, char *file)
 	struct stat s;
 	md5_ctx_t ctx;
 	int ret = 0;
-	int fd;
+	int fd, bufsize;
+	char *buf;
 
 	if (quiet < 2)
 		fprintf(stderr, "Verifying %s against %s ...\n", mtd, file);
@@ -440,10 +474,15 @@ mtd_verify(const char *mtd, char *file)
 		return -1;
 	}
 
+	buf = mtd_iobuf_alloc(&bufsize);
+	if (!buf) {
+		ret = -1;
+		goto out;
+	}
+
 	md5_begin(&ctx);
 	do {
-		char buf[256];
-		int len = (s.st_size > sizeof(buf)) ? (sizeof(buf)) : (s.st_size);
+		int len = (s.st_size > bufsize) ? (bufsize) : (s.st_size);
 		int rlen = read(fd, buf, len);
 
 		if (rlen < 0) {
@@ -470,10 +509,259 @@ mtd_verify(const char *mtd, char *file)
 		fprintf(stderr, "Failed\n");
 
 out:
+	free(buf);
 	close(fd);
 	return ret;
 }
 
+struct image_ring_slot {
+	char *data;
+	int len;
+	int pos;
+};
+
+/*
+ * Read-ahead ring for the image: a reader thread fills erase block sized
+ * slots from the image fd while the main thread erases and programs flash.
+ */
+struct image_ring {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct image_ring_slot *slots;
+	int n_slots;
+	int head;
+	int count;
+	int fd;
+	int error;
+	bool eof;
+	uint64_t read_ns;
+};
+
+static struct image_ring *ring;
+
+static struct {
+	bool readahead;
+	uint64_t readahead_ns;
+	uint64_t read_ns;
+	uint64_t erase_ns;
+	uint64_t write_ns;
+	int erase_blocks;
+	int write_blocks;
+	int same_blocks;
+} write_stats;
+
+static uint64_t
+time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *
+image_ring_reader(void *arg)
+{
+	struct image_ring *ring = arg;
+	struct image_ring_slot *slot;
+	uint64_t start;
+	ssize_t r;
+	int len, err;
+
+	do {
+		pthread_mutex_lock(&ring->lock);
+		while (ring->count == ring->n_slots)
+			pthread_cond_wait(&ring->cond, &ring->lock);
+		slot = &ring->slots[(ring->head + ring->count) % ring->n_slots];
+		pthread_mutex_unlock(&ring->lock);
+
+		start = time_ns();
+		len = err = 0;
+		while (len < erasesize) {
+			r = read(ring->fd, slot->data + len, erasesize - len);
+			if (r < 0) {
+				if ((errno == EINTR) || (errno == EAGAIN))
+					continue;
+				err = errno;
+				break;
+			}
+
+			if (r == 0)
+				break;
+
+			len += r;
+		}
+
+		pthread_mutex_lock(&ring->lock);
+		ring->read_ns += time_ns() - start;
+		if (len > 0) {
+			slot->len = len;
+			slot->pos = 0;
+			ring->count++;
+		}
+		if (len < erasesize) {
+			ring->eof = true;
+			ring->error = err;
+		}
+		pthread_cond_broadcast(&ring->cond);
+		pthread_mutex_unlock(&ring->lock);
+	} while (len == erasesize);
+
+	return NULL;
+}
+
+static struct image_ring *
+image_ring_start(int imagefd, int n_slots)
+{
+	struct image_ring *ring;
+	int i;
+
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+
+	ring->slots = calloc(n_slots, sizeof(*ring->slots));
+	if (!ring->slots)
+		goto free_ring;
+
+	for (i = 0; i < n_slots; i++) {
+		ring->slots[i].data = malloc(erasesize);
+		if (!ring->slots[i].data)
+			goto free_slots;
+	}
+
+	ring->n_slots = n_slots;
+	ring->fd = imagefd;
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->cond, NULL);
+
+	if (pthread_create(&ring->thread, NULL, image_ring_reader, ring))
+		goto free_slots;
+
+	return ring;
+
+free_slots:
+	for (i = 0; i < n_slots; i++)
+		free(ring->slots[i].data);
+	free(ring->slots);
+free_ring:
+	free(ring);
+	return NULL;
+}
+
+static void
+image_ring_stop(struct image_ring *ring)
+{
+	int i;
+
+	pthread_join(ring->thread, NULL);
+	for (i = 0; i < ring->n_slots; i++)
+		free(ring->slots[i].data);
+	free(ring->slots);
+	free(ring);
+}
+
+/*
+ * Take up to len bytes from the ring. A full, untouched slot is handed
+ * over by swapping it with the write buffer instead of copying it.
+ */
+static ssize_t
+image_ring_read(struct image_ring *ring, char **dest, int ofs, int len)
+{
+	struct image_ring_slot *slot;
+	ssize_t ret = 0;
+	char *tmp;
+
+	pthread_mutex_lock(&ring->lock);
+	while (!ring->count && !ring->eof)
+		pthread_cond_wait(&ring->cond, &ring->lock);
+
+	if (!ring->count) {
+		if (ring->error) {
+			errno = ring->error;
+			ret = -1;
+		}
+		goto out;
+	}
+
+	slot = &ring->slots[ring->head];
+	if (!ofs && !slot->pos && slot->len == len) {
+		tmp = *dest;
+		*dest = slot->data;
+		slot->data = tmp;
+		ret = len;
+	} else {
+		ret = MIN(len, slot->len - slot->pos);
+		memcpy(*dest + ofs, slot->data + slot->pos, ret);
+	}
+
+	slot->pos += ret;
+	if (slot->pos == slot->len) {
+		ring->head = (ring->head + 1) % ring->n_slots;
+		ring->count--;
+		pthread_cond_broadcast(&ring->cond);
+	}
+
+out:
+	pthread_mutex_unlock(&ring->lock);
+	return ret;
+}
+
+static ssize_t
+image_read(int imagefd)
+{
+	uint64_t start = time_ns();
+	ssize_t r;
+
+	if (ring)
+		r = image_ring_read(ring, &buf, buflen, erasesize - buflen);
+	else
+		r = read(imagefd, buf + buflen, erasesize - buflen);
+
+	write_stats.read_ns += time_ns() - start;
+	return r;
+}
+
+static void
+print_write_stats(uint64_t total_ns)
+{
+	fprintf(stderr, "Timing: total %.3fs, ", total_ns / 1e9);
+	if (write_stats.readahead)
+		fprintf(stderr, "read %.3fs (stalled %.3fs), ",
+			write_stats.readahead_ns / 1e9, write_stats.read_ns / 1e9);
+	else
+		fprintf(stderr, "read %.3fs, ", write_stats.read_ns / 1e9);
+	fprintf(stderr, "erase %.3fs (%d blocks), write %.3fs (%d blocks)",
+		write_stats.erase_ns / 1e9, write_stats.erase_blocks,
+		write_stats.write_ns / 1e9, write_stats.write_blocks);
+	if (incremental)
+		fprintf(stderr, ", %d unchanged blocks skipped", write_stats.same_blocks);
+	fprintf(stderr, "\n");
+}
+
+/*
+ * Check whether the erase block at offset already holds the data that is
+ * about to be written, so that erasing and programming it can be skipped.
+ */
+static bool
+mtd_block_matches(int fd, int offset, const char *data, int len)
+{
+	uint64_t start = time_ns();
+	bool ret;
+
+	if (!cmpbuf)
+		cmpbuf = malloc(erasesize);
+	if (!cmpbuf)
+		return false;
+
+	ret = pread(fd, cmpbuf, len, offset) == len &&
+	      !memcmp(cmpbuf, data, len);
+	write_stats.read_ns += time_ns() - start;
+
+	return ret;
+}
+
 static void
 indicate_writing(const char *mtd)
 {
@@ -496,6 +784,8 @@ mtd_write(int imagefd, const char *mtd, char *fis_layout, size_t part_offset)
 	int buflen_raw = 0;
 	int jffs2_replaced = 0;
 	int skip_bad_blocks = 0;
+	bool same;
+	uint64_t start, write_start;
 
 #ifdef FIS_SUPPORT
 	static struct fis_part new_parts[MAX_ARGS];
@@ -561,6 +851,13 @@ next:
 	}
 
 	r = 0;
+	write_start = time_ns();
+
+	if (readahead_blocks > 0) {
+		ring = image_ring_start(imagefd, readahead_blocks);
+		if (!ring)
+			fprintf(stderr, "Failed to set up image read-ahead, reading synchronously\n");
+	}
 
 resume:
 	next = strchr(mtd, ':');
@@ -596,7 +893,7 @@ resume:
 	for (;;) {
 		/* buffer may contain data already (from trx check or last mtd partition write attempt) */
 		while (buflen < erasesize) {
-			r = read(imagefd, buf + buflen, erasesize - buflen);
+			r = image_read(imagefd);
 			if (r < 0) {
 				if ((errno == EINTR) || (errno == EAGAIN))
 					continue;
@@ -661,6 +958,7 @@ resume:
 		}
 
 		/* need to erase the next block before writing data to it */
+		same = false;
 		if(!no_erase)
 		{
 			while (w + buflen > e - skip_bad_blocks) {
@@ -679,7 +977,22 @@ resume:
 					continue;
 				}
 
-				if (mtd_erase_block(fd, e + part_offset) < 0) {
+				if (incremental && !offset && w == e - skip_bad_blocks &&
+				    mtd_block_matches(fd, e + part_offset, buf, buflen)) {
+					if (!quiet)
+						fprintf(stderr, "\b\b\b[s]");
+
+					/* block already holds this data */
+					same = true;
+					e += erasesize;
+					write_stats.same_blocks++;
+					break;
+				}
+
+				start = time_ns();
+				result = mtd_erase_block(fd, e + part_offset);
+				write_stats.erase_ns += time_ns() - start;
+				if (result < 0) {
 					if (next) {
 						if (w < e) {
 							write(fd, buf + offset, e - w);
@@ -699,19 +1012,28 @@ resume:
 
 				/* erase the chunk */
 				e += erasesize;
+				write_stats.erase_blocks++;
 			}
 		}
 
-		if (!quiet)
-			fprintf(stderr, "\b\b\b[w]");
-
-		if ((result = write(fd, buf + offset, buflen)) < buflen) {
-			if (result < 0) {
-				fprintf(stderr, "Error writing image.\n");
-				exit(1);
-			} else {
-				fprintf(stderr, "Insufficient space.\n");
-				exit(1);
+		if (same) {
+			lseek(fd, buflen, SEEK_CUR);
+		} else {
+			if (!quiet)
+				fprintf(stderr, "\b\b\b[w]");
+
+			start = time_ns();
+			result = write(fd, buf + offset, buflen);
+			write_stats.write_ns += time_ns() - start;
+			write_stats.write_blocks++;
+			if (result < buflen) {
+				if (result < 0) {
+					fprintf(stderr, "Error writing image.\n");
+					exit(1);
+				} else {
+					fprintf(stderr, "Insufficient space.\n");
+					exit(1);
+				}
 			}
 		}
 		w += buflen;
@@ -731,6 +1053,13 @@ resume:
 		offset = 0;
 	}
 
+	if (ring) {
+		write_stats.readahead = true;
+		write_stats.readahead_ns = ring->read_ns;
+		image_ring_stop(ring);
+		ring = NULL;
+	}
+
 	if (jffs2_replaced) {
 		switch (imageformat) {
 		case MTD_IMAGE_FORMAT_TRX:
@@ -760,6 +1089,9 @@ resume:
 	if (quiet < 2)
 		fprintf(stderr, "\n");
 
+	if (show_timing)
+		print_write_stats(time_ns() - write_start);
+
 #ifdef FIS_SUPPORT
 	if (fis_layout) {
 		if (fis_remap(old_parts, n_old, new_parts, n_new) < 0)
@@ -827,6 +1159,11 @@ static void usage(void)
 	"        -j <name>               integrate <file> into jffs2 data when writing an image\n"
 	"        -s <number>             skip the first n bytes when appending data to the jffs2 partiton, defaults to \"0\"\n"
 	"        -p <number>             write beginning at partition offset\n"
+	"        -a <count>              read the image ahead into <count> erase block buffers while\n"
+	"                                erasing and writing (for write)\n"
+	"        -T                      print read/erase/write timing after writing\n"
+	"        -I                      incremental write: skip erasing and writing blocks that\n"
+	"                                already hold the image data (for write)\n"
 	"        -l <length>             the length of data that we want to dump\n");
 	if (mtd_fixtrx) {
 	    fprintf(stderr,
@@ -901,7 +1238,7 @@ int main (int argc, char **argv)
 #ifdef FIS_SUPPORT
 			"F:"
 #endif
-			"frnqe:d:s:j:p:o:c:t:l:M:")) != -1)
+			"frnqTIa:e:d:s:j:p:o:c:t:l:M:")) != -1)
 		switch (ch) {
 			case 'f':
 				force = 1;
@@ -926,6 +1263,20 @@ int main (int argc, char **argv)
 			case 'q':
 				quiet++;
 				break;
+			case 'a':
+				errno = 0;
+				readahead_blocks = strtoul(optarg, 0, 0);
+				if (errno) {
+					fprintf(stderr, "-a: illegal numeric string\n");
+					usage();
+				}
+				break;
+			case 'T':
+				show_timing = 1;
+				break;
+			case 'I':
+				incremental = 1;
+				break;
 			case 'e':
 				i = 0;
 				while ((erase[i] != NULL) && ((i + 1) < MAX_ARGS))
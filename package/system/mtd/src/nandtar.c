@@ -0,0 +1,444 @@
+/*
+ * nandtar.c
+ *
+ * Reads a sysupgrade tar stream in a single pass, either to index and
+ * verify it or to feed its members to flash writer commands.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <libubox/md5.h>
+
+#define TAR_BLOCK	512
+#define BUF_SIZE	(64 * 1024)
+
+struct tar_header {
+	char name[100];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];
+	char mtime[12];
+	char chksum[8];
+	char typeflag;
+	char linkname[100];
+	char magic[6];
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[155];
+	char pad[12];
+};
+
+struct member {
+	const char *name;
+	const char *cmd;
+	int done;
+};
+
+static char buf[BUF_SIZE];
+static struct member *members;
+static int n_members;
+
+static int
+read_full(void *data, size_t len)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < len) {
+		r = read(STDIN_FILENO, (char *) data + done, len - done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return -1;
+		done += r;
+	}
+
+	return 0;
+}
+
+static int
+write_full(int fd, const void *data, size_t len)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < len) {
+		r = write(fd, (const char *) data + done, len - done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return -1;
+		done += r;
+	}
+
+	return 0;
+}
+
+static int
+parse_number(const char *field, size_t len, uint64_t *val)
+{
+	const unsigned char *p = (const unsigned char *) field;
+	size_t i = 0;
+
+	*val = 0;
+
+	/* GNU base-256 encoding for large values */
+	if (p[0] & 0x80) {
+		*val = p[0] & 0x7f;
+		for (i = 1; i < len; i++)
+			*val = (*val << 8) | p[i];
+		return 0;
+	}
+
+	while (i < len && p[i] == ' ')
+		i++;
+
+	for (; i < len && p[i] >= '0' && p[i] <= '7'; i++)
+		*val = (*val << 3) | (p[i] - '0');
+
+	if (i < len && p[i] && p[i] != ' ')
+		return -1;
+
+	return 0;
+}
+
+static int
+header_valid(const struct tar_header *hdr)
+{
+	const unsigned char *p = (const unsigned char *) hdr;
+	uint64_t chksum;
+	unsigned int sum = 0;
+	int i;
+
+	if (parse_number(hdr->chksum, sizeof(hdr->chksum), &chksum))
+		return 0;
+
+	for (i = 0; i < TAR_BLOCK; i++) {
+		if (i >= offsetof(struct tar_header, chksum) &&
+		    i < offsetof(struct tar_header, typeflag))
+			sum += ' ';
+		else
+			sum += p[i];
+	}
+
+	return sum == chksum;
+}
+
+static int
+header_empty(const struct tar_header *hdr)
+{
+	const char *p = (const char *) hdr;
+	int i;
+
+	for (i = 0; i < TAR_BLOCK; i++)
+		if (p[i])
+			return 0;
+
+	return 1;
+}
+
+static pid_t
+spawn(const char *cmd, int *fd)
+{
+	int pfd[2];
+	pid_t pid;
+
+	if (pipe(pfd))
+		return -1;
+
+	pid = fork();
+	if (pid < 0) {
+		close(pfd[0]);
+		close(pfd[1]);
+		return -1;
+	}
+
+	if (!pid) {
+		dup2(pfd[0], STDIN_FILENO);
+		/* keep our stdout reserved for the checksum report */
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+		close(pfd[0]);
+		close(pfd[1]);
+		execl("/bin/sh", "sh", "-c", cmd, NULL);
+		_exit(127);
+	}
+
+	close(pfd[0]);
+	*fd = pfd[1];
+
+	return pid;
+}
+
+static struct member *
+find_member(const char *name)
+{
+	int i;
+
+	for (i = 0; i < n_members; i++)
+		if (!strcmp(members[i].name, name))
+			return &members[i];
+
+	return NULL;
+}
+
+/*
+ * Consume the data of one member including its padding, hashing it
+ * and passing it on to a writer if one is given.
+ */
+static int
+process_data(const char *name, uint64_t size, int fd, uint8_t *digest,
+	     uint8_t *magic)
+{
+	uint64_t left = (size + TAR_BLOCK - 1) & ~(uint64_t) (TAR_BLOCK - 1);
+	uint64_t pos = 0;
+	size_t len, used;
+	md5_ctx_t ctx;
+
+	memset(magic, 0, 4);
+	md5_begin(&ctx);
+
+	while (left) {
+		len = left < sizeof(buf) ? left : sizeof(buf);
+		if (read_full(buf, len)) {
+			fprintf(stderr, "Truncated tar member %s\n", name);
+			return -1;
+		}
+
+		used = size - pos < len ? size - pos : len;
+		if (!pos)
+			memcpy(magic, buf, used < 4 ? used : 4);
+
+		md5_hash(buf, used, &ctx);
+
+		if (fd >= 0 && used && write_full(fd, buf, used)) {
+			fprintf(stderr, "Failed to pass on %s\n", name);
+			return -1;
+		}
+
+		pos += used;
+		left -= len;
+	}
+
+	md5_end(digest, &ctx);
+
+	return 0;
+}
+
+static int
+write_member(struct member *m, uint64_t size, uint8_t *digest,
+	     uint8_t *magic)
+{
+	struct sigaction sa = { .sa_handler = SIG_IGN }, old;
+	int status, ret, fd;
+	pid_t pid;
+
+	pid = spawn(m->cmd, &fd);
+	if (pid < 0) {
+		fprintf(stderr, "Failed to start writer for %s\n", m->name);
+		return -1;
+	}
+
+	/* a writer bailing out early must not kill us with SIGPIPE */
+	sigaction(SIGPIPE, &sa, &old);
+	ret = process_data(m->name, size, fd, digest, magic);
+	close(fd);
+	sigaction(SIGPIPE, &old, NULL);
+
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status)) {
+		fprintf(stderr, "Writer for %s failed\n", m->name);
+		ret = -1;
+	}
+
+	m->done = 1;
+
+	return ret;
+}
+
+static void
+print_digest(const uint8_t *digest)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		printf("%02x", digest[i]);
+}
+
+/*
+ * Walk the archive once. In list mode every regular file is reported
+ * as "<name> <size> <magic> <md5>", in write mode the selected members
+ * are streamed to their writers and reported as "<name> <md5>".
+ */
+static int
+walk_tar(int list)
+{
+	struct tar_header hdr;
+	char name[PATH_MAX];
+	char longname[PATH_MAX] = "";
+	uint8_t digest[16];
+	uint8_t magic[4];
+	struct member *m;
+	uint64_t size;
+	int ret;
+
+	while (1) {
+		if (read_full(&hdr, sizeof(hdr))) {
+			fprintf(stderr, "Truncated tar archive\n");
+			return -1;
+		}
+
+		/* end of archive, the second zero block is optional */
+		if (header_empty(&hdr))
+			break;
+
+		if (!header_valid(&hdr)) {
+			fprintf(stderr, "Bad tar header checksum\n");
+			return -1;
+		}
+
+		if (parse_number(hdr.size, sizeof(hdr.size), &size)) {
+			fprintf(stderr, "Bad tar member size\n");
+			return -1;
+		}
+
+		/* GNU long name, the name itself is stored as member data */
+		if (hdr.typeflag == 'L') {
+			if (size >= sizeof(longname) ||
+			    read_full(longname, (size + TAR_BLOCK - 1) &
+					      ~(uint64_t) (TAR_BLOCK - 1))) {
+				fprintf(stderr, "Bad tar long name\n");
+				return -1;
+			}
+			longname[size] = 0;
+			continue;
+		}
+
+		if (longname[0]) {
+			strcpy(name, longname);
+			longname[0] = 0;
+		} else if (hdr.prefix[0] && !memcmp(hdr.magic, "ustar", 6)) {
+			snprintf(name, sizeof(name), "%.*s/%.*s",
+				 (int) sizeof(hdr.prefix), hdr.prefix,
+				 (int) sizeof(hdr.name), hdr.name);
+		} else {
+			snprintf(name, sizeof(name), "%.*s",
+				 (int) sizeof(hdr.name), hdr.name);
+		}
+
+		if (hdr.typeflag != '0' && hdr.typeflag != 0) {
+			/* directories, links and extended headers */
+			if (process_data(name, size, -1, digest, magic))
+				return -1;
+			continue;
+		}
+
+		m = list ? NULL : find_member(name);
+		if (m && !m->done)
+			ret = write_member(m, size, digest, magic);
+		else
+			ret = process_data(name, size, -1, digest, magic);
+
+		if (ret)
+			return -1;
+
+		if (list)
+			printf("%s %llu %02x%02x%02x%02x ", name,
+			       (unsigned long long) size,
+			       magic[0], magic[1], magic[2], magic[3]);
+		else if (m)
+			printf("%s ", name);
+		else
+			continue;
+
+		print_digest(digest);
+		printf("\n");
+	}
+
+	/* drain what is left so the decompressor can exit cleanly */
+	while (read(STDIN_FILENO, buf, sizeof(buf)) > 0)
+		;
+
+	return 0;
+}
+
+static int
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s list\n"
+		"       %s write <member> <command> [<member> <command>...]\n"
+		"\n"
+		"Reads a tar archive from stdin in a single pass.\n"
+		"list:  verify the archive and print \"<name> <size> <magic> <md5>\"\n"
+		"       for every regular file\n"
+		"write: pipe each <member> into \"sh -c <command>\" and print\n"
+		"       \"<name> <md5>\" for the data that was written\n",
+		prog, prog);
+
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	if (argc < 2)
+		return usage(argv[0]);
+
+	if (!strcmp(argv[1], "list")) {
+		if (argc != 2)
+			return usage(argv[0]);
+
+		return walk_tar(1) ? 1 : 0;
+	}
+
+	if (strcmp(argv[1], "write") != 0 || argc < 4 || argc % 2)
+		return usage(argv[0]);
+
+	n_members = (argc - 2) / 2;
+	members = calloc(n_members, sizeof(*members));
+	if (!members)
+		return 1;
+
+	for (i = 0; i < n_members; i++) {
+		members[i].name = argv[2 + 2 * i];
+		members[i].cmd = argv[3 + 2 * i];
+	}
+
+	if (walk_tar(0))
+		return 1;
+
+	for (i = 0; i < n_members; i++) {
+		if (!members[i].done) {
+			fprintf(stderr, "Member %s not found\n", members[i].name);
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -161,9 +161,11 @@ mtd_fixtrx(const char *mtd, size_t offset, size_t data_size)
 	int fd;
 	struct trx_header *trx;
 	char *first_block;
-	char *buf, *to;
+	char *buf;
 	ssize_t res;
 	size_t block_offset;
+	size_t crc_size = 0;
+	uint32_t crc = 0xFFFFFFFF;
 
 	if (quiet < 2)
 		fprintf(stderr, "Trying to fix trx header in %s at 0x%zx...\n", mtd, offset);
@@ -206,13 +208,13 @@ mtd_fixtrx(const char *mtd, size_t offset, size_t data_size)
 		exit(1);
 	}
 
-	buf = malloc(data_size);
+	/* Checksum the data one erase block at a time */
+	buf = malloc(erasesize);
 	if (!buf) {
 		perror("malloc");
 		exit(1);
 	}
 
-	to = buf;
 	while (data_size) {
 		size_t read_block_offset = data_offset & ~(erasesize - 1);
 		size_t read_chunk;
@@ -222,21 +224,23 @@ mtd_fixtrx(const char *mtd, size_t offset, size_t data_size)
 
 		/* Read from good blocks only to match CFE behavior */
 		if (!mtd_block_is_bad(fd, read_block_offset)) {
-			res = pread(fd, to, read_chunk, data_offset);
+			res = pread(fd, buf, read_chunk, data_offset);
 			if (res != read_chunk) {
 				perror("pread");
 				exit(1);
 			}
-			to += read_chunk;
+			crc = crc32(crc, buf, read_chunk);
+			crc_size += read_chunk;
 		}
 
 		data_offset += read_chunk;
 		data_size -= read_chunk;
 	}
-	data_size = to - buf;
+	data_size = crc_size;
+	free(buf);
 
 	if (trx->len == STORE32_LE(data_size + TRX_CRC32_DATA_OFFSET) &&
-	    trx->crc32 == STORE32_LE(crc32buf(buf, data_size))) {
+	    trx->crc32 == STORE32_LE(crc)) {
 		if (quiet < 2)
 			fprintf(stderr, "Header already fixed, exiting\n");
 		close(fd);
@@ -245,7 +249,7 @@ mtd_fixtrx(const char *mtd, size_t offset, size_t data_size)
 
 	trx->len = STORE32_LE(data_size + offsetof(struct trx_header, flag_version));
 
-	trx->crc32 = STORE32_LE(crc32buf(buf, data_size));
+	trx->crc32 = STORE32_LE(crc);
 	if (mtd_erase_block(fd, block_offset)) {
 		fprintf(stderr, "Can't erease block at 0x%zx (%s)\n", block_offset, strerror(errno));
 		exit(1);
@@ -73,35 +73,44 @@ int
 wrg_fix_md5(struct wrg_header *shdr, int fd, size_t data_offset, size_t data_size)
 {
 	char *buf;
+	size_t done, chunk;
 	ssize_t res;
 	MD5_CTX ctx;
 	unsigned char digest[16];
 	int i;
 	int err = 0;
 
-	buf = malloc(data_size);
+	/* Hash the data one erase block at a time */
+	buf = malloc(erasesize);
 	if (!buf) {
 		err = -ENOMEM;
 		goto err_out;
 	}
 
-	res = pread(fd, buf, data_size, data_offset);
-	if (res != data_size) {
-		perror("pread");
-		err = -EIO;
-		goto err_free;
-	}
-
 	MD5_Init(&ctx);
 	MD5_Update(&ctx, (char *)&shdr->offset, sizeof(shdr->offset));
 	MD5_Update(&ctx, (char *)&shdr->devname, sizeof(shdr->devname));
-	MD5_Update(&ctx, buf, data_size);
+	for (done = 0; done < data_size; done += chunk) {
+		chunk = data_size - done;
+		if (chunk > erasesize)
+			chunk = erasesize;
+
+		res = pread(fd, buf, chunk, data_offset + done);
+		if (res != chunk) {
+			perror("pread");
+			err = -EIO;
+			goto err_free;
+		}
+
+		MD5_Update(&ctx, buf, chunk);
+	}
 	MD5_Final(digest, &ctx);
 
 	if (!memcmp(digest, shdr->digest, sizeof(digest))) {
 		if (quiet < 2)
 			fprintf(stderr, "the header is fixed already\n");
-		return -1;
+		err = -1;
+		goto err_free;
 	}
 
 	if (quiet < 2) {
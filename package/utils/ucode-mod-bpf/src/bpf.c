@@ -11,12 +11,18 @@
 #include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 
+#include <libubox/uloop.h>
+
 #include "ucode/module.h"
 
 #define err_return_int(err, ...) do { set_error(err, __VA_ARGS__); return -1; } while(0)
 #define err_return(err, ...) do { set_error(err, __VA_ARGS__); return NULL; } while(0)
 #define TRUE ucv_boolean_new(true)
 
+#define UC_BPF_BATCH_SIZE	256
+#define UC_BPF_BATCH_SIZE_MAX	(16 * UC_BPF_BATCH_SIZE)
+#define UC_BPF_PERFBUF_PAGES	8
+
 static uc_value_t *registry;
 static uc_vm_t *debug_vm;
 
@@ -35,6 +41,42 @@ struct uc_bpf_map {
 	unsigned int key_size, val_size;
 };
 
+struct uc_bpf_map_batch {
+	int fd;
+	unsigned int key_size, val_size, val_stride;
+	unsigned int size, count;
+	bool started, done, fallback;
+	uint8_t *keys, *vals;
+	uint8_t *token;
+};
+
+enum {
+	EVENT_BUF_MAP,
+	EVENT_BUF_CB,
+	__EVENT_BUF_MAX
+};
+
+struct uc_bpf_event_buf {
+	struct uloop_fd fd;
+	uc_vm_t *vm;
+	uc_value_t *res;
+	int registry_index;
+
+	struct ring_buffer *rb;
+	struct perf_buffer *pb;
+
+	uc_value_t *batch;
+	unsigned int batch_size;
+
+	struct {
+		uint64_t records;
+		uint64_t bytes;
+		uint64_t batches;
+		uint64_t lost;
+		uint64_t dropped;
+	} stats;
+};
+
 struct uc_bpf_map_iter {
 	int fd;
 	unsigned int key_size;
@@ -452,49 +494,501 @@ uc_bpf_map_delete(uc_vm_t *vm, size_t nargs)
 	return ucv_string_new_length(val, map->val_size);
 }
 
+static bool
+uc_bpf_batch_unsupported(int err)
+{
+	/* ENOTSUPP (524) is leaked by maps without batch ops */
+	return err == EINVAL || err == EOPNOTSUPP || err == 524;
+}
+
+/*
+ * Per-CPU maps return one 8 byte aligned value per possible CPU for
+ * every entry, size the value buffers the same way.
+ */
+static int
+uc_bpf_map_val_stride(struct uc_bpf_map *map)
+{
+	struct bpf_map_info info = {};
+	__u32 len = sizeof(info);
+	int ncpus;
+
+	if (bpf_obj_get_info_by_fd(map->fd.fd, &info, &len))
+		err_return_int(errno, NULL);
+
+	switch (info.type) {
+	case BPF_MAP_TYPE_PERCPU_HASH:
+	case BPF_MAP_TYPE_PERCPU_ARRAY:
+	case BPF_MAP_TYPE_LRU_PERCPU_HASH:
+	case BPF_MAP_TYPE_PERCPU_CGROUP_STORAGE:
+		break;
+	default:
+		return map->val_size;
+	}
+
+	ncpus = libbpf_num_possible_cpus();
+	if (ncpus < 0)
+		err_return_int(-ncpus, "possible cpus");
+
+	return ((map->val_size + 7) & ~7) * ncpus;
+}
+
+static int
+uc_bpf_map_batch_init(struct uc_bpf_map_batch *b, struct uc_bpf_map *map,
+		      unsigned int size)
+{
+	unsigned int token_size = map->key_size;
+	int stride;
+
+	if (token_size < sizeof(uint64_t))
+		token_size = sizeof(uint64_t);
+
+	memset(b, 0, sizeof(*b));
+
+	stride = uc_bpf_map_val_stride(map);
+	if (stride < 0)
+		return -1;
+
+	b->fd = map->fd.fd;
+	b->key_size = map->key_size;
+	b->val_size = map->val_size;
+	b->val_stride = stride;
+	b->size = size;
+	b->keys = malloc(size * b->key_size);
+	b->vals = calloc(size, b->val_stride);
+	b->token = calloc(1, token_size);
+	if (!b->keys || !b->vals || !b->token)
+		err_return_int(ENOMEM, NULL);
+
+	return 0;
+}
+
+static void
+uc_bpf_map_batch_free(struct uc_bpf_map_batch *b)
+{
+	free(b->keys);
+	free(b->vals);
+	free(b->token);
+}
+
+static int
+uc_bpf_map_batch_grow(struct uc_bpf_map_batch *b)
+{
+	unsigned int size = b->size * 2;
+	uint8_t *keys, *vals;
+
+	if (size > UC_BPF_BATCH_SIZE_MAX)
+		return -1;
+
+	keys = realloc(b->keys, size * b->key_size);
+	if (!keys)
+		return -1;
+
+	b->keys = keys;
+
+	vals = realloc(b->vals, size * b->val_stride);
+	if (!vals)
+		return -1;
+
+	b->vals = vals;
+	b->size = size;
+
+	return 0;
+}
+
+/*
+ * The token holds the key following the last one returned, so that the
+ * caller may delete the returned entries without get_next_key restarting
+ * from the first entry of a hash map.
+ */
+static int
+uc_bpf_map_batch_next_fallback(struct uc_bpf_map_batch *b)
+{
+	unsigned int count = 0;
+
+	if (!b->started) {
+		b->started = true;
+		if (bpf_map_get_next_key(b->fd, NULL, b->token)) {
+			b->done = true;
+			return 0;
+		}
+	}
+
+	while (count < b->size) {
+		void *key = b->keys + count * b->key_size;
+		void *val = b->vals + count * b->val_stride;
+		bool found;
+
+		memcpy(key, b->token, b->key_size);
+
+		/* entry deleted since fetching the key */
+		found = !bpf_map_lookup_elem(b->fd, key, val);
+
+		if (bpf_map_get_next_key(b->fd, key, b->token))
+			b->done = true;
+
+		if (found)
+			count++;
+
+		if (b->done)
+			break;
+	}
+
+	b->count = count;
+
+	return count;
+}
+
+/*
+ * Fetch the next chunk of keys and values into the batch buffers.
+ * Uses BPF_MAP_LOOKUP_BATCH if available, falls back to walking the map
+ * with one get_next_key/lookup pair per entry on older kernels.
+ * Returns the number of entries fetched, 0 at the end of the map and
+ * -1 on error.
+ */
+static int
+uc_bpf_map_batch_next(struct uc_bpf_map_batch *b)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	__u32 count;
+	int ret;
+
+	b->count = 0;
+	if (b->done)
+		return 0;
+
+	if (b->fallback)
+		return uc_bpf_map_batch_next_fallback(b);
+
+retry:
+	count = b->size;
+	ret = bpf_map_lookup_batch(b->fd, b->started ? b->token : NULL, b->token,
+				   b->keys, b->vals, &count, &opts);
+	if (ret && errno == ENOENT) {
+		b->done = true;
+		ret = 0;
+	}
+
+	if (!ret) {
+		b->started = true;
+		b->count = count;
+		return count;
+	}
+
+	/* hash bucket larger than the batch buffer */
+	if (errno == ENOSPC && !uc_bpf_map_batch_grow(b))
+		goto retry;
+
+	if (b->started || !uc_bpf_batch_unsupported(errno))
+		err_return_int(errno, "batch lookup");
+
+	b->fallback = true;
+
+	return uc_bpf_map_batch_next_fallback(b);
+}
+
+static int
+uc_bpf_map_update_batch(struct uc_bpf_map *map, void *keys, void *vals,
+			unsigned int stride, unsigned int count, uint64_t flags)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts,
+			    .elem_flags = flags);
+	unsigned int i = 0;
+	__u32 done = count;
+
+	if (!count)
+		return 0;
+
+	if (!bpf_map_update_batch(map->fd.fd, keys, vals, &done, &opts))
+		return count;
+
+	if (!uc_bpf_batch_unsupported(errno))
+		err_return_int(errno, "batch update");
+
+	for (i = 0; i < count; i++)
+		if (bpf_map_update_elem(map->fd.fd,
+					(uint8_t *)keys + i * map->key_size,
+					(uint8_t *)vals + i * stride, flags))
+			err_return_int(errno, "update");
+
+	return count;
+}
+
+static int
+uc_bpf_map_delete_batch_keys(struct uc_bpf_map *map, void *keys,
+			     unsigned int count)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	unsigned int i, deleted = 0;
+	int err = 0;
+	__u32 done;
+
+	while (count > 0) {
+		done = count;
+		if (!bpf_map_delete_batch(map->fd.fd, keys, &done, &opts))
+			return deleted + count;
+
+		if (errno != ENOENT || done >= count)
+			break;
+
+		/* skip the missing entry and continue with the rest */
+		deleted += done;
+		keys = (uint8_t *)keys + (done + 1) * map->key_size;
+		count -= done + 1;
+	}
+
+	if (!count)
+		return deleted;
+
+	/*
+	 * Entries removed concurrently are not an error, anything else is
+	 * reported once the remaining keys have been tried.
+	 */
+	for (i = 0; i < count; i++) {
+		if (!bpf_map_delete_elem(map->fd.fd, (uint8_t *)keys + i * map->key_size))
+			deleted++;
+		else if (errno != ENOENT)
+			err = errno;
+	}
+
+	if (err)
+		err_return_int(err, "delete");
+
+	return deleted;
+}
+
 static uc_value_t *
 uc_bpf_map_delete_all(uc_vm_t *vm, size_t nargs)
 {
 	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
 	uc_value_t *filter = uc_fn_arg(0);
-	bool has_next;
-	void *key, *next;
+	struct uc_bpf_map_batch b;
+	bool error = false;
+	int count;
 
 	if (!map)
 		err_return(EINVAL, NULL);
 
-	key = alloca(map->key_size);
-	next = alloca(map->key_size);
-	has_next = !bpf_map_get_next_key(map->fd.fd, NULL, next);
-	while (has_next) {
-		bool skip = false;
+	if (uc_bpf_map_batch_init(&b, map, UC_BPF_BATCH_SIZE)) {
+		uc_bpf_map_batch_free(&b);
+		return NULL;
+	}
 
-		memcpy(key, next, map->key_size);
-		has_next = !bpf_map_get_next_key(map->fd.fd, next, next);
+	while (!error && (count = uc_bpf_map_batch_next(&b)) > 0) {
+		int i, n_del = 0;
 
-		if (ucv_is_callable(filter)) {
-			uc_value_t *rv;
+		for (i = 0; i < count; i++) {
+			void *key = b.keys + i * b.key_size;
+			bool skip = false;
 
-			uc_value_push(ucv_get(filter));
-			uc_value_push(ucv_string_new_length((const char *)key, map->key_size));
-			if (uc_call(1) != EXCEPTION_NONE)
-				break;
+			if (ucv_is_callable(filter)) {
+				uc_value_t *rv;
 
-			rv = uc_vm_stack_pop(vm);
-			if (!rv)
-				break;
+				uc_value_push(ucv_get(filter));
+				uc_value_push(ucv_string_new_length((const char *)key, map->key_size));
+				if (uc_call(1) != EXCEPTION_NONE) {
+					error = true;
+					break;
+				}
 
-			skip = !ucv_is_truish(rv);
-			ucv_put(rv);
+				rv = uc_vm_stack_pop(vm);
+				if (!rv) {
+					error = true;
+					break;
+				}
+
+				skip = !ucv_is_truish(rv);
+				ucv_put(rv);
+			}
+
+			if (skip)
+				continue;
+
+			if (n_del != i)
+				memcpy(b.keys + n_del * b.key_size, key, b.key_size);
+			n_del++;
 		}
 
-		if (!skip)
-			bpf_map_delete_elem(map->fd.fd, key);
+		if (n_del && uc_bpf_map_delete_batch_keys(map, b.keys, n_del) < 0)
+			error = true;
 	}
 
+	uc_bpf_map_batch_free(&b);
+
+	if (error || count < 0)
+		return NULL;
+
 	return TRUE;
 }
 
+static uc_value_t *
+uc_bpf_map_dump(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	struct uc_bpf_map_batch b;
+	uc_value_t *rv = NULL;
+	int count, i;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (uc_bpf_map_batch_init(&b, map, UC_BPF_BATCH_SIZE))
+		goto out;
+
+	rv = ucv_array_new(vm);
+	while ((count = uc_bpf_map_batch_next(&b)) > 0) {
+		for (i = 0; i < count; i++) {
+			uc_value_t *entry = ucv_array_new_length(vm, 2);
+
+			ucv_array_push(entry, ucv_string_new_length((const char *)b.keys + i * b.key_size, b.key_size));
+			ucv_array_push(entry, ucv_string_new_length((const char *)b.vals + i * b.val_stride, b.val_size));
+			ucv_array_push(rv, entry);
+		}
+	}
+
+	if (count < 0) {
+		ucv_put(rv);
+		rv = NULL;
+	}
+
+out:
+	uc_bpf_map_batch_free(&b);
+
+	return rv;
+}
+
+static int
+uc_bpf_map_batch_add(struct uc_bpf_map *map, struct uc_bpf_map_batch *b,
+		     uc_value_t *a_key, uc_value_t *a_val)
+{
+	void *key, *val;
+
+	key = uc_bpf_map_arg(a_key, "key", map->key_size);
+	if (!key)
+		return -1;
+
+	memcpy(b->keys + b->count * b->key_size, key, b->key_size);
+
+	if (!b->vals)
+		goto out;
+
+	val = uc_bpf_map_arg(a_val, "value", map->val_size);
+	if (!val)
+		return -1;
+
+	memcpy(b->vals + b->count * b->val_stride, val, b->val_size);
+
+out:
+	b->count++;
+
+	return 0;
+}
+
+static uc_value_t *
+uc_bpf_map_set_batch(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *entries = uc_fn_arg(0);
+	uc_value_t *a_flags = uc_fn_arg(1);
+	struct uc_bpf_map_batch b;
+	uc_value_t *rv = NULL;
+	uint64_t flags;
+	size_t len, i;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (!a_flags)
+		flags = BPF_ANY;
+	else if (ucv_type(a_flags) != UC_INTEGER)
+		err_return(EINVAL, "flags");
+	else
+		flags = ucv_int64_get(a_flags);
+
+	switch (ucv_type(entries)) {
+	case UC_ARRAY:
+		len = ucv_array_length(entries);
+		break;
+	case UC_OBJECT:
+		len = ucv_object_length(entries);
+		break;
+	default:
+		err_return(EINVAL, "entries");
+	}
+
+	if (uc_bpf_map_batch_init(&b, map, len ? len : 1))
+		goto out;
+
+	if (ucv_type(entries) == UC_ARRAY) {
+		for (i = 0; i < len; i++) {
+			uc_value_t *entry = ucv_array_get(entries, i);
+
+			if (ucv_type(entry) != UC_ARRAY ||
+			    ucv_array_length(entry) != 2) {
+				set_error(EINVAL, "entry %zu", i);
+				goto out;
+			}
+
+			if (uc_bpf_map_batch_add(map, &b, ucv_array_get(entry, 0),
+						 ucv_array_get(entry, 1)))
+				goto out;
+		}
+	} else {
+		ucv_object_foreach(entries, key, val) {
+			uc_value_t *a_key = ucv_string_new(key);
+			int ret;
+
+			ret = uc_bpf_map_batch_add(map, &b, a_key, val);
+			ucv_put(a_key);
+			if (ret)
+				goto out;
+		}
+	}
+
+	if (uc_bpf_map_update_batch(map, b.keys, b.vals, b.val_stride, b.count, flags) < 0)
+		goto out;
+
+	rv = ucv_int64_new(b.count);
+
+out:
+	uc_bpf_map_batch_free(&b);
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_map_delete_batch(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *keys = uc_fn_arg(0);
+	struct uc_bpf_map_batch b;
+	uc_value_t *rv = NULL;
+	size_t len, i;
+	int ret;
+
+	if (!map || ucv_type(keys) != UC_ARRAY)
+		err_return(EINVAL, NULL);
+
+	len = ucv_array_length(keys);
+	if (uc_bpf_map_batch_init(&b, map, len ? len : 1))
+		goto out;
+
+	free(b.vals);
+	b.vals = NULL;
+
+	for (i = 0; i < len; i++)
+		if (uc_bpf_map_batch_add(map, &b, ucv_array_get(keys, i), NULL))
+			goto out;
+
+	ret = uc_bpf_map_delete_batch_keys(map, b.keys, b.count);
+	if (ret >= 0)
+		rv = ucv_int64_new(ret);
+
+out:
+	uc_bpf_map_batch_free(&b);
+
+	return rv;
+}
+
 static uc_value_t *
 uc_bpf_map_iterator(uc_vm_t *vm, size_t nargs)
 {
@@ -557,40 +1051,310 @@ uc_bpf_map_foreach(uc_vm_t *vm, size_t nargs)
 {
 	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
 	uc_value_t *func = uc_fn_arg(0);
-	bool has_next;
-	void *key, *next;
+	struct uc_bpf_map_batch b;
 	bool ret = false;
+	bool stop = false;
+	int count, i;
 
-	key = alloca(map->key_size);
-	next = alloca(map->key_size);
-	has_next = !bpf_map_get_next_key(map->fd.fd, NULL, next);
+	if (!map)
+		err_return(EINVAL, NULL);
 
-	while (has_next) {
-		uc_value_t *rv;
-		bool stop;
+	if (uc_bpf_map_batch_init(&b, map, UC_BPF_BATCH_SIZE))
+		goto out;
 
-		memcpy(key, next, map->key_size);
-		has_next = !bpf_map_get_next_key(map->fd.fd, next, next);
+	while (!stop && (count = uc_bpf_map_batch_next(&b)) > 0) {
+		for (i = 0; i < count; i++) {
+			uc_value_t *rv;
 
-		uc_value_push(ucv_get(func));
-		uc_value_push(ucv_string_new_length((const char *)key, map->key_size));
+			uc_value_push(ucv_get(func));
+			uc_value_push(ucv_string_new_length((const char *)b.keys + i * b.key_size, b.key_size));
 
-		if (uc_call(1) != EXCEPTION_NONE)
-			break;
+			if (uc_call(1) != EXCEPTION_NONE) {
+				stop = true;
+				break;
+			}
 
-		rv = uc_vm_stack_pop(vm);
-		stop = (ucv_type(rv) == UC_BOOLEAN && !ucv_boolean_get(rv));
-		ucv_put(rv);
+			rv = uc_vm_stack_pop(vm);
+			stop = (ucv_type(rv) == UC_BOOLEAN && !ucv_boolean_get(rv));
+			ucv_put(rv);
 
-		if (stop)
-			break;
+			if (stop)
+				break;
 
-		ret = true;
+			ret = true;
+		}
 	}
 
+out:
+	uc_bpf_map_batch_free(&b);
+
 	return ucv_boolean_new(ret);
 }
 
+static int
+registry_set(uc_value_t *val)
+{
+	size_t i, len;
+
+	/* index 0 is reserved for the debug handler */
+	len = ucv_array_length(registry);
+	for (i = 1; i < len; i++)
+		if (ucv_array_get(registry, i) == NULL)
+			break;
+
+	ucv_array_set(registry, i, ucv_get(val));
+
+	return i;
+}
+
+static void
+uc_bpf_event_buf_add(struct uc_bpf_event_buf *buf, const void *data,
+		     size_t size)
+{
+	if (!buf->batch)
+		buf->batch = ucv_array_new(buf->vm);
+
+	ucv_array_push(buf->batch, ucv_string_new_length(data, size));
+	buf->stats.records++;
+	buf->stats.bytes += size;
+}
+
+static void
+uc_bpf_event_buf_flush(struct uc_bpf_event_buf *buf)
+{
+	uc_value_t *batch = buf->batch;
+	uc_vm_t *vm = buf->vm;
+	size_t len;
+
+	if (!batch)
+		return;
+
+	buf->batch = NULL;
+	len = ucv_array_length(batch);
+	buf->stats.batches++;
+
+	uc_vm_stack_push(vm, ucv_get(ucv_resource_value_get(buf->res, EVENT_BUF_CB)));
+	uc_vm_stack_push(vm, batch);
+	if (uc_vm_call(vm, false, 1) == EXCEPTION_NONE)
+		ucv_put(uc_vm_stack_pop(vm));
+	else
+		buf->stats.dropped += len;
+}
+
+static int
+uc_bpf_ringbuf_sample_cb(void *ctx, void *data, size_t size)
+{
+	uc_bpf_event_buf_add(ctx, data, size);
+
+	return 0;
+}
+
+static void
+uc_bpf_perfbuf_sample_cb(void *ctx, int cpu, void *data, __u32 size)
+{
+	uc_bpf_event_buf_add(ctx, data, size);
+}
+
+static void
+uc_bpf_perfbuf_lost_cb(void *ctx, int cpu, __u64 cnt)
+{
+	struct uc_bpf_event_buf *buf = ctx;
+
+	buf->stats.lost += cnt;
+}
+
+/*
+ * Records are collected in an array and passed to the callback once per
+ * batch_size records (ring buffer) or per CPU buffer (perf buffer). The
+ * callback may close the buffer, so check for that after each batch.
+ */
+static int
+uc_bpf_event_buf_consume(struct uc_bpf_event_buf *buf)
+{
+	uint64_t records = buf->stats.records;
+	size_t i, n_bufs;
+	int ret;
+
+	if (buf->rb) {
+		do {
+			ret = ring_buffer__consume_n(buf->rb, buf->batch_size);
+			uc_bpf_event_buf_flush(buf);
+		} while (buf->rb && ret > 0 && (unsigned int)ret >= buf->batch_size);
+	} else if (buf->pb) {
+		n_bufs = perf_buffer__buffer_cnt(buf->pb);
+		for (i = 0; buf->pb && i < n_bufs; i++) {
+			ret = perf_buffer__consume_buffer(buf->pb, i);
+			uc_bpf_event_buf_flush(buf);
+			if (ret < 0 && ret != -ENOENT)
+				break;
+		}
+	}
+
+	return buf->stats.records - records;
+}
+
+static void
+uc_bpf_event_buf_poll_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct uc_bpf_event_buf *buf = container_of(fd, struct uc_bpf_event_buf, fd);
+	uc_value_t *res = ucv_get(buf->res);
+
+	uc_bpf_event_buf_consume(buf);
+	ucv_put(res);
+}
+
+static void
+uc_bpf_event_buf_close(struct uc_bpf_event_buf *buf)
+{
+	if (!buf->rb && !buf->pb)
+		return;
+
+	uloop_fd_delete(&buf->fd);
+	ring_buffer__free(buf->rb);
+	perf_buffer__free(buf->pb);
+	buf->rb = NULL;
+	buf->pb = NULL;
+	ucv_put(buf->batch);
+	buf->batch = NULL;
+
+	if (buf->registry_index > 0)
+		ucv_array_set(registry, buf->registry_index, NULL);
+	buf->registry_index = 0;
+}
+
+static uc_value_t *
+uc_bpf_event_buf_create(uc_vm_t *vm, size_t nargs, bool perf)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *cb = uc_fn_arg(0);
+	uc_value_t *opts = uc_fn_arg(1);
+	struct uc_bpf_event_buf *buf;
+	unsigned int batch_size = UC_BPF_BATCH_SIZE;
+	unsigned int pages = UC_BPF_PERFBUF_PAGES;
+	uc_value_t *res, *val;
+	int fd;
+
+	if (!map || !ucv_is_callable(cb))
+		err_return(EINVAL, NULL);
+
+	if (opts && ucv_type(opts) != UC_OBJECT)
+		err_return(EINVAL, "options argument");
+
+	if ((val = ucv_object_get(opts, "batch", NULL)) != NULL) {
+		if (ucv_type(val) != UC_INTEGER || ucv_int64_get(val) <= 0)
+			err_return(EINVAL, "batch");
+
+		batch_size = ucv_int64_get(val);
+	}
+
+	if ((val = ucv_object_get(opts, "pages", NULL)) != NULL) {
+		/* must be a power of two */
+		if (ucv_type(val) != UC_INTEGER || ucv_int64_get(val) <= 0 ||
+		    (ucv_int64_get(val) & (ucv_int64_get(val) - 1)))
+			err_return(EINVAL, "pages");
+
+		pages = ucv_int64_get(val);
+	}
+
+	res = ucv_resource_create_ex(vm, "bpf.event_buf", (void **)&buf,
+				     __EVENT_BUF_MAX, sizeof(*buf));
+	ucv_resource_value_set(res, EVENT_BUF_MAP, ucv_get(_uc_fn_this_res(vm)));
+	ucv_resource_value_set(res, EVENT_BUF_CB, ucv_get(cb));
+	buf->vm = vm;
+	buf->res = res;
+	buf->batch_size = batch_size;
+
+	if (perf) {
+		buf->pb = perf_buffer__new(map->fd.fd, pages, uc_bpf_perfbuf_sample_cb,
+					   uc_bpf_perfbuf_lost_cb, buf, NULL);
+		if (!buf->pb)
+			goto error;
+
+		fd = perf_buffer__epoll_fd(buf->pb);
+	} else {
+		buf->rb = ring_buffer__new(map->fd.fd, uc_bpf_ringbuf_sample_cb, buf, NULL);
+		if (!buf->rb)
+			goto error;
+
+		fd = ring_buffer__epoll_fd(buf->rb);
+	}
+
+	buf->fd.fd = fd;
+	buf->fd.cb = uc_bpf_event_buf_poll_cb;
+	uloop_fd_add(&buf->fd, ULOOP_READ);
+
+	/* keep the buffer alive while it is registered with uloop */
+	buf->registry_index = registry_set(res);
+
+	return res;
+
+error:
+	set_error(errno, NULL);
+	ucv_put(res);
+	return NULL;
+}
+
+static uc_value_t *
+uc_bpf_map_ringbuf(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_event_buf_create(vm, nargs, false);
+}
+
+static uc_value_t *
+uc_bpf_map_perfbuf(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_event_buf_create(vm, nargs, true);
+}
+
+static uc_value_t *
+uc_bpf_event_buf_consume_fn(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_event_buf *buf = uc_fn_thisval("bpf.event_buf");
+	uc_value_t *res;
+	int count;
+
+	if (!buf || (!buf->rb && !buf->pb))
+		err_return(EINVAL, NULL);
+
+	res = ucv_get(buf->res);
+	count = uc_bpf_event_buf_consume(buf);
+	ucv_put(res);
+
+	return ucv_int64_new(count);
+}
+
+static uc_value_t *
+uc_bpf_event_buf_stats(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_event_buf *buf = uc_fn_thisval("bpf.event_buf");
+	uc_value_t *rv;
+
+	if (!buf)
+		err_return(EINVAL, NULL);
+
+	rv = ucv_object_new(vm);
+	ucv_object_add(rv, "records", ucv_uint64_new(buf->stats.records));
+	ucv_object_add(rv, "bytes", ucv_uint64_new(buf->stats.bytes));
+	ucv_object_add(rv, "batches", ucv_uint64_new(buf->stats.batches));
+	ucv_object_add(rv, "lost", ucv_uint64_new(buf->stats.lost));
+	ucv_object_add(rv, "dropped", ucv_uint64_new(buf->stats.dropped));
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_event_buf_close_fn(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_event_buf *buf = uc_fn_thisval("bpf.event_buf");
+
+	if (!buf)
+		err_return(EINVAL, NULL);
+
+	uc_bpf_event_buf_close(buf);
+
+	return TRUE;
+}
+
 static uc_value_t *
 uc_bpf_obj_pin(uc_vm_t *vm, size_t nargs, const char *type)
 {
@@ -778,8 +1542,13 @@ static const uc_function_list_t map_fns[] = {
 	{ "set",			uc_bpf_map_set },
 	{ "delete",			uc_bpf_map_delete },
 	{ "delete_all",			uc_bpf_map_delete_all },
+	{ "delete_batch",		uc_bpf_map_delete_batch },
+	{ "set_batch",			uc_bpf_map_set_batch },
+	{ "dump",			uc_bpf_map_dump },
 	{ "foreach",			uc_bpf_map_foreach },
 	{ "iterator",			uc_bpf_map_iterator },
+	{ "ringbuf",			uc_bpf_map_ringbuf },
+	{ "perfbuf",			uc_bpf_map_perfbuf },
 };
 
 static void uc_bpf_fd_free(void *ptr)
@@ -795,6 +1564,19 @@ static const uc_function_list_t map_iter_fns[] = {
 	{ "next_int",			uc_bpf_map_iter_next_int },
 };
 
+static const uc_function_list_t event_buf_fns[] = {
+	{ "consume",			uc_bpf_event_buf_consume_fn },
+	{ "stats",			uc_bpf_event_buf_stats },
+	{ "close",			uc_bpf_event_buf_close_fn },
+};
+
+static void uc_bpf_event_buf_free(void *ptr)
+{
+	struct uc_bpf_event_buf *buf = ptr;
+
+	uc_bpf_event_buf_close(buf);
+}
+
 static const uc_function_list_t prog_fns[] = {
 	{ "pin",			uc_bpf_program_pin },
 	{ "tc_attach",			uc_bpf_program_tc_attach },
@@ -820,5 +1602,6 @@ void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
 	uc_type_declare(vm, "bpf.module", module_fns, module_free);
 	uc_type_declare(vm, "bpf.map", map_fns, uc_bpf_fd_free);
 	uc_type_declare(vm, "bpf.map_iter", map_iter_fns, NULL);
+	uc_type_declare(vm, "bpf.event_buf", event_buf_fns, uc_bpf_event_buf_free);
 	uc_type_declare(vm, "bpf.program", prog_fns, uc_bpf_fd_free);
 }
@@ -0,0 +1,65 @@
+#!/usr/bin/env bash
+# Time the per-file sha256sum loop sysupgrade used to run against
+# /usr/libexec/conffiles on a synthetic tree of conffiles.
+#
+# Needs ucode with the fs and digest modules.
+#
+# Usage: conffiles-bench.sh [<number of files>]
+
+set -e -o pipefail
+
+count="${1:-1000}"
+topdir="$(cd "$(dirname "$0")/.." && pwd)"
+conffiles="$topdir/package/base-files/files/usr/libexec/conffiles"
+
+root="$(mktemp -d)"
+trap 'rm -rf "$root"' EXIT
+
+mkdir -p "$root/usr/lib/opkg" "$root/etc/bench"
+
+# one package per 10 files, every 4th file modified after install
+for pkg in $(seq 0 $(( (count - 1) / 10 ))); do
+	echo "Package: bench-$pkg"
+	echo "Conffiles:"
+	for i in $(seq $(( pkg * 10 )) $(( pkg * 10 + 9 ))); do
+		[ "$i" -lt "$count" ] || break
+		file="/etc/bench/file-$i"
+		printf 'option value %d\n' "$i" > "$root$file"
+		echo " $file $(sha256sum "$root$file" | cut -d' ' -f1)"
+		[ $(( i % 4 )) -ne 0 ] || echo changed >> "$root$file"
+	done
+	echo
+done > "$root/usr/lib/opkg/status"
+
+legacy() {
+	awk '
+		BEGIN { conffiles = 0 }
+		/^Conffiles:/ { conffiles = 1; next }
+		!/^ / { conffiles = 0; next }
+		conffiles == 1 { print }
+	' "$root/usr/lib/opkg/status" | while read file csum; do
+		[ -r "$root$file" ] || continue
+
+		echo "${csum}  $root${file}" | sha256sum --status -c - || echo "$file"
+	done
+}
+
+run() {
+	local start end
+
+	start=$(date +%s%N)
+	"$@" | sort > "$root/out.$1"
+	end=$(date +%s%N)
+	printf '%-40s %6d ms\n' "${*##*/}" $(( (end - start) / 1000000 ))
+}
+
+run legacy
+run ucode "$conffiles" -R "$root" changed
+# cache entries are only kept for files older than a few seconds
+sleep 3
+run ucode "$conffiles" -R "$root" -c "$root/cache" changed
+run ucode "$conffiles" -R "$root" -c "$root/cache" changed
+run ucode "$conffiles" -R "$root" -c "$root/cache" changed
+
+cmp "$root/out.legacy" "$root/out.ucode" && \
+	echo "$(wc -l < "$root/out.ucode") changed files, output matches"
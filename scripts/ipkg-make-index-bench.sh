@@ -0,0 +1,77 @@
+#!/usr/bin/env bash
+# Time ipkg-make-index.sh against the old sequential shell loop on a generated
+# feed of dummy packages and check that both produce the same index.
+#
+# Usage: ipkg-make-index-bench.sh [<number of packages>]
+
+set -e -o pipefail
+
+count="${1:-5000}"
+topdir="$(cd "$(dirname "$0")/.." && pwd)"
+
+feed="$(mktemp -d)"
+trap 'rm -rf "$feed"' EXIT
+
+if [ -z "$MKHASH" ]; then
+	MKHASH="$feed/mkhash"
+	printf '#!/bin/sh\nsha256sum "$2" | cut -d" " -f1\n' > "$MKHASH"
+	chmod +x "$MKHASH"
+fi
+export MKHASH
+
+echo "Generating $count packages" >&2
+mkdir -p "$feed/pkgs" "$feed/work"
+(
+	cd "$feed/work"
+	echo "2.0" > debian-binary
+	tar -czf data.tar.gz debian-binary
+	for i in $(seq 1 "$count"); do
+		cat > control <<-EOF
+		Package: dummy-$i
+		Version: 1.0-r$i
+		Depends: libc
+		Architecture: all
+		Installed-Size: $i
+		Description: Dummy package $i
+		EOF
+		tar -czf control.tar.gz ./control
+		tar -czf "$feed/pkgs/dummy-${i}_1.0-r${i}_all.ipk" \
+			./debian-binary ./data.tar.gz ./control.tar.gz
+	done
+)
+
+legacy() {
+	for pkg in `find . -name '*.ipk' | sort`; do
+		file_size=$(stat -L -c%s $pkg)
+		sha256sum=$($MKHASH sha256 $pkg)
+		sed_safe_pkg=`echo $pkg | sed -e 's/^\.\///g' -e 's/\\//\\\\\\//g'`
+		tar -xzOf $pkg ./control.tar.gz | tar xzOf - ./control | sed -e "s/^Description:/Filename: $sed_safe_pkg\\
+Size: $file_size\\
+SHA256sum: $sha256sum\\
+Description:/"
+		echo ""
+	done
+}
+
+run() {
+	local out="$1" start end
+	shift
+
+	start=$(date +%s%N)
+	( cd "$feed/pkgs" && "$@" ) > "$feed/$out" 2>/dev/null
+	end=$(date +%s%N)
+	printf '%-12s %8d ms\n' "$out" $(( (end - start) / 1000000 ))
+}
+
+export IPKG_INDEX_CACHE="$feed/cache"
+
+run legacy legacy
+run cold "$topdir/scripts/ipkg-make-index.sh" .
+run warm "$topdir/scripts/ipkg-make-index.sh" .
+touch "$feed/pkgs/dummy-1_1.0-r1_all.ipk"
+run one-changed "$topdir/scripts/ipkg-make-index.sh" .
+
+for out in cold warm one-changed; do
+	cmp "$feed/legacy" "$feed/$out"
+done
+echo "all indexes are identical"
@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""
+Generate the opkg "Packages" index of a directory of .ipk files.
+
+Every package is opened once: its control file is read straight out of the
+nested control.tar.gz and its SHA256 is computed in the same process, so no
+tar, sed or hash helper is forked per package.  Packages are indexed by a
+pool of IPKG_INDEX_JOBS workers (one per CPU by default).
+
+If IPKG_INDEX_CACHE is set, or TMP_DIR is, the entries are kept in a cache
+file per package directory, keyed on the path, size, mtime and inode of each
+package, so unchanged packages are not unpacked and hashed again.
+"""
+
+import fnmatch
+import hashlib
+import io
+import json
+import os
+import re
+import sys
+import tarfile
+from concurrent.futures import ProcessPoolExecutor
+
+SKIP_NAMES = ("kernel", "libc")
+DESCRIPTION_RE = re.compile(rb"^Description:", re.MULTILINE)
+
+
+def find_packages(pkg_dir: str) -> list:
+    # Same list and order as `find $pkg_dir -name '*.ipk' | sort` in the C
+    # locale: directories are not followed through symlinks and paths are
+    # sorted bytewise.
+    prefix = pkg_dir if pkg_dir.endswith("/") else pkg_dir + "/"
+    found = []
+
+    for root, dirs, files in os.walk(pkg_dir):
+        rel = os.path.relpath(root, pkg_dir)
+        base = prefix if rel == "." else prefix + rel + "/"
+        for name in dirs + files:
+            if fnmatch.fnmatchcase(name, "*.ipk"):
+                found.append(base + name)
+
+    return sorted(found, key=os.fsencode)
+
+
+def extract_member(tar: tarfile.TarFile, name: str) -> bytes:
+    member = tar.getmember(name)
+    data = tar.extractfile(member)
+    if data is None:
+        raise tarfile.TarError(f"{name} is not a regular file")
+    return data.read()
+
+
+def index_package(pkg: str, size: int) -> bytes:
+    sha256 = hashlib.sha256()
+    with open(pkg, "rb") as f:
+        raw = f.read()
+    sha256.update(raw)
+
+    with tarfile.open(fileobj=io.BytesIO(raw), mode="r:gz") as outer:
+        control_tar = extract_member(outer, "./control.tar.gz")
+    with tarfile.open(fileobj=io.BytesIO(control_tar), mode="r:gz") as inner:
+        control = extract_member(inner, "./control")
+
+    filename = pkg[2:] if pkg.startswith("./") else pkg
+    fields = b"Filename: %s\nSize: %d\nSHA256sum: %s\nDescription:" % (
+        os.fsencode(filename),
+        size,
+        sha256.hexdigest().encode(),
+    )
+    return DESCRIPTION_RE.sub(lambda m: fields, control) + b"\n"
+
+
+def index_job(job: tuple) -> tuple:
+    pkg, size = job
+    try:
+        return pkg, index_package(pkg, size)
+    except (OSError, EOFError, tarfile.TarError, KeyError) as e:
+        return pkg, e
+
+
+def cache_path(pkg_dir: str):
+    cache_dir = os.environ.get("IPKG_INDEX_CACHE")
+    if not cache_dir and os.environ.get("TMP_DIR"):
+        cache_dir = os.path.join(os.environ["TMP_DIR"], "ipkg-index-cache")
+    if not cache_dir:
+        return None
+
+    os.makedirs(cache_dir, exist_ok=True)
+    name = hashlib.sha256(os.fsencode(os.path.abspath(pkg_dir))).hexdigest()
+    return os.path.join(cache_dir, name + ".json")
+
+
+def load_cache(path) -> dict:
+    if not path:
+        return {}
+    try:
+        with open(path, encoding="latin-1") as f:
+            cache = json.load(f)
+    except (OSError, ValueError):
+        return {}
+    return cache if isinstance(cache, dict) else {}
+
+
+def save_cache(path, cache: dict):
+    # Written to a temporary file and renamed, so an interrupted run never
+    # leaves a truncated cache behind.
+    tmp = "%s.%d" % (path, os.getpid())
+    try:
+        with open(tmp, "w", encoding="latin-1") as f:
+            json.dump(cache, f)
+        os.replace(tmp, path)
+    except OSError as e:
+        print(f"ipkg-make-index: cannot write cache {path}: {e}", file=sys.stderr)
+        try:
+            os.unlink(tmp)
+        except OSError:
+            pass
+
+
+def main() -> int:
+    if len(sys.argv) < 2 or not os.path.isdir(sys.argv[1]):
+        print("Usage: ipkg-make-index <package_directory>", file=sys.stderr)
+        return 1
+
+    pkg_dir = sys.argv[1]
+    found = find_packages(pkg_dir)
+    if not found:
+        sys.stdout.buffer.write(b"\n")
+        return 0
+
+    pkgs = [
+        pkg for pkg in found
+        if os.path.basename(pkg).split("_", 1)[0] not in SKIP_NAMES
+    ]
+
+    path = cache_path(pkg_dir)
+    cache = load_cache(path)
+    entries = {}
+    keys = {}
+    jobs = []
+    failed = False
+
+    for pkg in pkgs:
+        try:
+            st = os.stat(pkg)
+        except OSError as e:
+            print(f"Failed to index package {pkg}: {e}", file=sys.stderr)
+            failed = True
+            continue
+
+        keys[pkg] = [st.st_size, st.st_mtime_ns, st.st_ino]
+        cached = cache.get(os.path.abspath(pkg))
+        if cached and cached[0] == keys[pkg]:
+            entries[pkg] = cached[1].encode("latin-1")
+        else:
+            jobs.append((pkg, st.st_size))
+
+    for pkg, _ in jobs:
+        print(f"Generating index for package {pkg}", file=sys.stderr)
+
+    nproc = int(os.environ.get("IPKG_INDEX_JOBS") or os.cpu_count() or 1)
+    if nproc > 1 and len(jobs) > 1:
+        with ProcessPoolExecutor(max_workers=min(nproc, len(jobs))) as pool:
+            results = list(pool.map(index_job, jobs, chunksize=16))
+    else:
+        results = [index_job(job) for job in jobs]
+
+    for pkg, result in results:
+        if isinstance(result, Exception):
+            print(f"Failed to index package {pkg}: {result}", file=sys.stderr)
+            failed = True
+        else:
+            entries[pkg] = result
+
+    if path:
+        save_cache(path, {
+            os.path.abspath(pkg): [keys[pkg], entry.decode("latin-1")]
+            for pkg, entry in entries.items()
+        })
+
+    if failed:
+        print(f"ipkg-make-index: failed to index some packages in {pkg_dir}",
+              file=sys.stderr)
+        return 1
+
+    out = sys.stdout.buffer
+    for pkg in pkgs:
+        out.write(entries[pkg])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
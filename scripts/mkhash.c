@@ -85,10 +85,15 @@
 #include <sys/endian.h>
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/stat.h>
 
@@ -131,6 +136,19 @@ be32dec(const void *buf)
 
 	return (((uint32_t) be16dec(p)) << 16) | be16dec(p + 2);
 }
+
+static uint64_t
+le64dec(const void *buf)
+{
+	const uint8_t *p = buf;
+	uint64_t v = 0;
+	int i;
+
+	for (i = 7; i >= 0; i--)
+		v = (v << 8) | p[i];
+
+	return v;
+}
 #endif
 
 #define MD5_DIGEST_LENGTH	16
@@ -674,82 +692,648 @@ SHA256_Final(unsigned char digest[static SHA256_DIGEST_LENGTH], SHA256_CTX *ctx)
 	memset(ctx, 0, sizeof(*ctx));
 }
 
-static void *hash_buf(FILE *f, int *len)
+#define SHA512_BLOCK_LENGTH		128
+#define SHA512_DIGEST_LENGTH		64
+
+typedef struct SHA512Context {
+	uint64_t state[8];
+	uint64_t count;
+	uint8_t buf[SHA512_BLOCK_LENGTH];
+} SHA512_CTX;
+
+#define ROTR64(x, n)	(((x) >> (n)) | ((x) << (64 - (n))))
+
+#define SHA512_S0(x)	(ROTR64(x, 28) ^ ROTR64(x, 34) ^ ROTR64(x, 39))
+#define SHA512_S1(x)	(ROTR64(x, 14) ^ ROTR64(x, 18) ^ ROTR64(x, 41))
+#define SHA512_s0(x)	(ROTR64(x, 1) ^ ROTR64(x, 8) ^ ((x) >> 7))
+#define SHA512_s1(x)	(ROTR64(x, 19) ^ ROTR64(x, 61) ^ ((x) >> 6))
+
+/* Initial hash value, shared with BLAKE2b */
+static const uint64_t SHA512_IV[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+/*
+ * SHA512 block compression function.  The 512-bit state is transformed via
+ * the 1024-bit input block to produce a new state.
+ */
+static void
+SHA512_Transform(uint64_t *state, const unsigned char block[128])
 {
-	static char buf[1024];
+	/* SHA512 round constants. */
+	static const uint64_t K[80] = {
+		0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL,
+		0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+		0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+		0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+		0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
+		0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+		0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL,
+		0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+		0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+		0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+		0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL,
+		0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+		0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL,
+		0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+		0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+		0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+		0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL,
+		0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+		0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL,
+		0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+		0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+		0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+		0xd192e819d6ef5218ULL, 0xd69906245565a910ULL,
+		0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+		0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
+		0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+		0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+		0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+		0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL,
+		0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+		0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL,
+		0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+		0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+		0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+		0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
+		0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+		0x28db77f523047d84ULL, 0x32caab7b40c72493ULL,
+		0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+		0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+		0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+	};
+	uint64_t W[80];
+	uint64_t S[8];
+	uint64_t t0, t1;
+	int i;
 
-	*len = fread(buf, 1, sizeof(buf), f);
+	/* 1. Prepare the message schedule W. */
+	for (i = 0; i < 16; i++)
+		W[i] = ((uint64_t) be32dec(block + i * 8) << 32) |
+		       be32dec(block + i * 8 + 4);
+	for (i = 16; i < 80; i++)
+		W[i] = SHA512_s1(W[i - 2]) + W[i - 7] +
+		       SHA512_s0(W[i - 15]) + W[i - 16];
 
-	return *len > 0 ? buf : NULL;
+	/* 2. Initialize working variables. */
+	memcpy(S, state, sizeof(S));
+
+	/* 3. Mix. */
+	for (i = 0; i < 80; i++) {
+		t0 = S[7] + SHA512_S1(S[4]) + Ch(S[4], S[5], S[6]) + K[i] + W[i];
+		t1 = SHA512_S0(S[0]) + Maj(S[0], S[1], S[2]);
+		S[7] = S[6];
+		S[6] = S[5];
+		S[5] = S[4];
+		S[4] = S[3] + t0;
+		S[3] = S[2];
+		S[2] = S[1];
+		S[1] = S[0];
+		S[0] = t0 + t1;
+	}
+
+	/* 4. Mix local working variables into global state */
+	for (i = 0; i < 8; i++)
+		state[i] += S[i];
 }
 
-static char *hash_string(unsigned char *buf, int len)
+static void
+SHA512_Init(SHA512_CTX *ctx)
+{
+	ctx->count = 0;
+	memcpy(ctx->state, SHA512_IV, sizeof(ctx->state));
+}
+
+static void
+SHA512_Update(SHA512_CTX *ctx, const void *in, size_t len)
 {
-	static char str[SHA256_DIGEST_LENGTH * 2 + 1];
+	const unsigned char *src = in;
+	size_t r = ctx->count & 0x7f;
+
+	ctx->count += len;
+
+	if (len < 128 - r) {
+		memcpy(&ctx->buf[r], src, len);
+		return;
+	}
+
+	memcpy(&ctx->buf[r], src, 128 - r);
+	SHA512_Transform(ctx->state, ctx->buf);
+	src += 128 - r;
+	len -= 128 - r;
+
+	while (len >= 128) {
+		SHA512_Transform(ctx->state, src);
+		src += 128;
+		len -= 128;
+	}
+
+	memcpy(ctx->buf, src, len);
+}
+
+static void
+SHA512_Final(unsigned char digest[static SHA512_DIGEST_LENGTH], SHA512_CTX *ctx)
+{
+	size_t r = ctx->count & 0x7f;
 	int i;
 
-	if (len * 2 + 1 > sizeof(str))
-		return NULL;
+	/* Pad to 112 mod 128, followed by the 128-bit bit count */
+	ctx->buf[r++] = 0x80;
+	if (r > 112) {
+		memset(&ctx->buf[r], 0, 128 - r);
+		SHA512_Transform(ctx->state, ctx->buf);
+		r = 0;
+	}
+	memset(&ctx->buf[r], 0, 112 - r);
+	be64enc(&ctx->buf[112], ctx->count >> 61);
+	be64enc(&ctx->buf[120], ctx->count << 3);
+	SHA512_Transform(ctx->state, ctx->buf);
 
-	for (i = 0; i < len; i++)
-		sprintf(&str[i * 2], "%02x", buf[i]);
+	for (i = 0; i < 8; i++)
+		be64enc(digest + i * 8, ctx->state[i]);
 
-	return str;
+	memset(ctx, 0, sizeof(*ctx));
 }
 
-static const char *md5_hash(FILE *f)
+/*
+ * BLAKE2b (RFC 7693), unkeyed with a 512-bit digest as printed by b2sum.
+ */
+#define BLAKE2B_BLOCK_LENGTH		128
+#define BLAKE2B_DIGEST_LENGTH		64
+
+typedef struct BLAKE2bContext {
+	uint64_t h[8];
+	uint64_t t[2];
+	size_t len;
+	uint8_t buf[BLAKE2B_BLOCK_LENGTH];
+} BLAKE2B_CTX;
+
+#define BLAKE2B_G(a, b, c, d, x, y)			\
+	do {						\
+		v[a] = v[a] + v[b] + (x);		\
+		v[d] = ROTR64(v[d] ^ v[a], 32);		\
+		v[c] = v[c] + v[d];			\
+		v[b] = ROTR64(v[b] ^ v[c], 24);		\
+		v[a] = v[a] + v[b] + (y);		\
+		v[d] = ROTR64(v[d] ^ v[a], 16);		\
+		v[c] = v[c] + v[d];			\
+		v[b] = ROTR64(v[b] ^ v[c], 63);		\
+	} while (0)
+
+static void
+BLAKE2b_Compress(BLAKE2B_CTX *ctx, const unsigned char block[128], bool last)
 {
-	MD5_CTX ctx;
-	unsigned char val[MD5_DIGEST_LENGTH];
-	void *buf;
-	int len;
+	static const uint8_t sigma[12][16] = {
+		{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+		{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+		{ 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+		{ 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+		{ 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+		{ 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+		{ 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+		{ 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+		{ 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+		{ 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+		{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+		{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+	};
+	uint64_t m[16], v[16];
+	int i;
 
-	MD5_begin(&ctx);
-	while ((buf = hash_buf(f, &len)) != NULL)
-		MD5_hash(buf, len, &ctx);
-	MD5_end(val, &ctx);
+	for (i = 0; i < 16; i++)
+		m[i] = le64dec(block + i * 8);
+
+	for (i = 0; i < 8; i++) {
+		v[i] = ctx->h[i];
+		v[i + 8] = SHA512_IV[i];
+	}
 
-	return hash_string(val, MD5_DIGEST_LENGTH);
+	v[12] ^= ctx->t[0];
+	v[13] ^= ctx->t[1];
+	if (last)
+		v[14] = ~v[14];
+
+	for (i = 0; i < 12; i++) {
+		const uint8_t *s = sigma[i];
+
+		BLAKE2B_G(0, 4, 8, 12, m[s[0]], m[s[1]]);
+		BLAKE2B_G(1, 5, 9, 13, m[s[2]], m[s[3]]);
+		BLAKE2B_G(2, 6, 10, 14, m[s[4]], m[s[5]]);
+		BLAKE2B_G(3, 7, 11, 15, m[s[6]], m[s[7]]);
+		BLAKE2B_G(0, 5, 10, 15, m[s[8]], m[s[9]]);
+		BLAKE2B_G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+		BLAKE2B_G(2, 7, 8, 13, m[s[12]], m[s[13]]);
+		BLAKE2B_G(3, 4, 9, 14, m[s[14]], m[s[15]]);
+	}
+
+	for (i = 0; i < 8; i++)
+		ctx->h[i] ^= v[i] ^ v[i + 8];
 }
 
-static const char *sha256_hash(FILE *f)
+static void
+BLAKE2b_Counter(BLAKE2B_CTX *ctx, size_t len)
 {
-	SHA256_CTX ctx;
-	unsigned char val[SHA256_DIGEST_LENGTH];
-	void *buf;
-	int len;
+	ctx->t[0] += len;
+	if (ctx->t[0] < len)
+		ctx->t[1]++;
+}
+
+static void
+BLAKE2b_Init(BLAKE2B_CTX *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	memcpy(ctx->h, SHA512_IV, sizeof(ctx->h));
+	/* digest length 64, no key, fanout and depth 1 */
+	ctx->h[0] ^= 0x01010000 ^ BLAKE2B_DIGEST_LENGTH;
+}
+
+static void
+BLAKE2b_Update(BLAKE2B_CTX *ctx, const void *in, size_t len)
+{
+	const unsigned char *src = in;
+	size_t fill;
+
+	if (!len)
+		return;
+
+	/* The last block is compressed in BLAKE2b_Final, keep it buffered */
+	fill = BLAKE2B_BLOCK_LENGTH - ctx->len;
+	if (len > fill) {
+		memcpy(&ctx->buf[ctx->len], src, fill);
+		BLAKE2b_Counter(ctx, BLAKE2B_BLOCK_LENGTH);
+		BLAKE2b_Compress(ctx, ctx->buf, false);
+		ctx->len = 0;
+		src += fill;
+		len -= fill;
+
+		while (len > BLAKE2B_BLOCK_LENGTH) {
+			BLAKE2b_Counter(ctx, BLAKE2B_BLOCK_LENGTH);
+			BLAKE2b_Compress(ctx, src, false);
+			src += BLAKE2B_BLOCK_LENGTH;
+			len -= BLAKE2B_BLOCK_LENGTH;
+		}
+	}
+
+	memcpy(&ctx->buf[ctx->len], src, len);
+	ctx->len += len;
+}
+
+static void
+BLAKE2b_Final(unsigned char digest[static BLAKE2B_DIGEST_LENGTH], BLAKE2B_CTX *ctx)
+{
+	int i, j;
+
+	BLAKE2b_Counter(ctx, ctx->len);
+	memset(&ctx->buf[ctx->len], 0, BLAKE2B_BLOCK_LENGTH - ctx->len);
+	BLAKE2b_Compress(ctx, ctx->buf, true);
+
+	for (i = 0; i < 8; i++)
+		for (j = 0; j < 8; j++)
+			digest[i * 8 + j] = ctx->h[i] >> (8 * j);
+
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+#define HASH_BUF_SIZE		(1024 * 1024)
+#define HASH_MAX_LENGTH		64
+#define HASH_MAX_THREADS	32
+#define HASH_BENCH_SIZE		(256 * 1024 * 1024)
+
+union hash_ctx {
+	MD5_CTX md5;
+	SHA256_CTX sha256;
+	SHA512_CTX sha512;
+	BLAKE2B_CTX blake2b;
+};
+
+static void md5_init(union hash_ctx *ctx)
+{
+	MD5_begin(&ctx->md5);
+}
+
+static void md5_update(union hash_ctx *ctx, const void *data, size_t len)
+{
+	MD5_hash(data, len, &ctx->md5);
+}
+
+static void md5_final(unsigned char *val, union hash_ctx *ctx)
+{
+	MD5_end(val, &ctx->md5);
+}
+
+static void sha256_init(union hash_ctx *ctx)
+{
+	SHA256_Init(&ctx->sha256);
+}
 
-	SHA256_Init(&ctx);
-	while ((buf = hash_buf(f, &len)) != NULL)
-		SHA256_Update(&ctx, buf, len);
-	SHA256_Final(val, &ctx);
+static void sha256_update(union hash_ctx *ctx, const void *data, size_t len)
+{
+	SHA256_Update(&ctx->sha256, data, len);
+}
 
-	return hash_string(val, SHA256_DIGEST_LENGTH);
+static void sha256_final(unsigned char *val, union hash_ctx *ctx)
+{
+	SHA256_Final(val, &ctx->sha256);
+}
+
+static void sha512_init(union hash_ctx *ctx)
+{
+	SHA512_Init(&ctx->sha512);
+}
+
+static void sha512_update(union hash_ctx *ctx, const void *data, size_t len)
+{
+	SHA512_Update(&ctx->sha512, data, len);
+}
+
+static void sha512_final(unsigned char *val, union hash_ctx *ctx)
+{
+	SHA512_Final(val, &ctx->sha512);
+}
+
+static void blake2b_init(union hash_ctx *ctx)
+{
+	BLAKE2b_Init(&ctx->blake2b);
+}
+
+static void blake2b_update(union hash_ctx *ctx, const void *data, size_t len)
+{
+	BLAKE2b_Update(&ctx->blake2b, data, len);
 }
 
+static void blake2b_final(unsigned char *val, union hash_ctx *ctx)
+{
+	BLAKE2b_Final(val, &ctx->blake2b);
+}
 
 struct hash_type {
 	const char *name;
-	const char *(*func)(FILE *f);
+	void (*init)(union hash_ctx *ctx);
+	void (*update)(union hash_ctx *ctx, const void *data, size_t len);
+	void (*final)(unsigned char *val, union hash_ctx *ctx);
 	int len;
 };
 
 struct hash_type types[] = {
-	{ "md5", md5_hash, MD5_DIGEST_LENGTH },
-	{ "sha256", sha256_hash, SHA256_DIGEST_LENGTH },
+	{ "md5", md5_init, md5_update, md5_final, MD5_DIGEST_LENGTH },
+	{ "sha256", sha256_init, sha256_update, sha256_final, SHA256_DIGEST_LENGTH },
+	{ "sha512", sha512_init, sha512_update, sha512_final, SHA512_DIGEST_LENGTH },
+	{ "blake2b", blake2b_init, blake2b_update, blake2b_final, BLAKE2B_DIGEST_LENGTH },
+};
+
+struct hash_job {
+	const char *filename;
+	char str[HASH_MAX_LENGTH * 2 + 1];
+	char err[256];
+	int ret;
+	bool done;
 };
 
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct hash_type *type;
+	struct hash_job *jobs;
+	int n_jobs;
+	int next;
+} pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void hash_string(char *str, unsigned char *buf, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		sprintf(&str[i * 2], "%02x", buf[i]);
+}
+
+static int hash_fd(struct hash_type *t, int fd, void *buf, char *str)
+{
+	unsigned char val[HASH_MAX_LENGTH];
+	union hash_ctx ctx;
+	ssize_t len;
+
+	t->init(&ctx);
+	while ((len = read(fd, buf, HASH_BUF_SIZE)) != 0) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		t->update(&ctx, buf, len);
+	}
+	t->final(val, &ctx);
+
+	hash_string(str, val, t->len);
+
+	return 0;
+}
+
+static void hash_file(struct hash_type *t, struct hash_job *job, void *buf)
+{
+	const char *filename = job->filename;
+	struct stat path_stat;
+	int fd;
+
+	job->ret = 1;
+
+	if (!filename || !strcmp(filename, "-")) {
+		fd = STDIN_FILENO;
+	} else {
+		if (!stat(filename, &path_stat) && S_ISDIR(path_stat.st_mode)) {
+			snprintf(job->err, sizeof(job->err),
+				 "Failed to open '%s': Is a directory", filename);
+			return;
+		}
+
+		fd = open(filename, O_RDONLY);
+		if (fd < 0) {
+			snprintf(job->err, sizeof(job->err),
+				 "Failed to open '%s'", filename);
+			return;
+		}
+	}
+
+	if (hash_fd(t, fd, buf, job->str))
+		snprintf(job->err, sizeof(job->err), "Failed to generate hash");
+	else
+		job->ret = 0;
+
+	if (fd != STDIN_FILENO)
+		close(fd);
+}
+
+static void *hash_worker(void *arg)
+{
+	struct hash_job *job;
+	void *buf;
+	int i;
+
+	buf = malloc(HASH_BUF_SIZE);
+
+	while (1) {
+		pthread_mutex_lock(&pool.lock);
+		i = pool.next < pool.n_jobs ? pool.next++ : -1;
+		pthread_mutex_unlock(&pool.lock);
+
+		if (i < 0)
+			break;
+
+		job = &pool.jobs[i];
+		if (buf) {
+			hash_file(pool.type, job, buf);
+		} else {
+			job->ret = 1;
+			snprintf(job->err, sizeof(job->err), "Out of memory");
+		}
+
+		pthread_mutex_lock(&pool.lock);
+		job->done = true;
+		/* results are printed in order, stop at the first error */
+		if (job->ret)
+			pool.next = pool.n_jobs;
+		pthread_cond_broadcast(&pool.cond);
+		pthread_mutex_unlock(&pool.lock);
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+static int print_job(struct hash_job *job, bool add_filename, bool no_newline)
+{
+	if (job->ret) {
+		fprintf(stderr, "%s\n", job->err);
+		return job->ret;
+	}
+
+	if (add_filename)
+		printf("%s %s%s", job->str, job->filename ? job->filename : "-",
+			no_newline ? "" : "\n");
+	else
+		printf("%s%s", job->str, no_newline ? "" : "\n");
+
+	return 0;
+}
+
+/*
+ * Hash the files with a pool of worker threads and print the results in
+ * the order given.
+ */
+static int hash_files(struct hash_type *t, const char **files, int n_files,
+	bool add_filename, bool no_newline)
+{
+	pthread_t threads[HASH_MAX_THREADS];
+	long n_threads;
+	int i, ret = 0;
+
+	pool.type = t;
+	pool.n_jobs = n_files;
+	pool.jobs = calloc(n_files, sizeof(*pool.jobs));
+	if (!pool.jobs) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (i = 0; i < n_files; i++)
+		pool.jobs[i].filename = files[i];
+
+	n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_threads > n_files)
+		n_threads = n_files;
+	if (n_threads > HASH_MAX_THREADS)
+		n_threads = HASH_MAX_THREADS;
+	if (n_threads < 1)
+		n_threads = 1;
+
+	for (i = 0; i < n_threads; i++)
+		if (pthread_create(&threads[i], NULL, hash_worker, NULL))
+			break;
+
+	n_threads = i;
+	if (!n_threads)
+		hash_worker(NULL);
+
+	for (i = 0; i < n_files; i++) {
+		struct hash_job *job = &pool.jobs[i];
+
+		pthread_mutex_lock(&pool.lock);
+		while (!job->done)
+			pthread_cond_wait(&pool.cond, &pool.lock);
+		pthread_mutex_unlock(&pool.lock);
+
+		ret = print_job(job, add_filename, no_newline);
+		if (ret)
+			break;
+	}
+
+	for (i = 0; i < n_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	free(pool.jobs);
+
+	return ret;
+}
+
+static int hash_bench(void)
+{
+	unsigned char val[HASH_MAX_LENGTH];
+	struct timespec start, end;
+	union hash_ctx ctx;
+	unsigned char *buf;
+	double secs;
+	size_t done;
+	int i;
+
+	buf = malloc(HASH_BUF_SIZE);
+	if (!buf) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (i = 0; i < HASH_BUF_SIZE; i++)
+		buf[i] = i * 131 + (i >> 8);
+
+	for (i = 0; i < ARRAY_SIZE(types); i++) {
+		struct hash_type *t = &types[i];
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		t->init(&ctx);
+		for (done = 0; done < HASH_BENCH_SIZE; done += HASH_BUF_SIZE)
+			t->update(&ctx, buf, HASH_BUF_SIZE);
+		t->final(val, &ctx);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		secs = (end.tv_sec - start.tv_sec) +
+		       (end.tv_nsec - start.tv_nsec) / 1e9;
+		printf("%-8s %8.1f MB/s\n", t->name, HASH_BENCH_SIZE / secs / 1e6);
+	}
+
+	free(buf);
+
+	return 0;
+}
+
 
 static int usage(const char *progname)
 {
 	int i;
 
 	fprintf(stderr, "Usage: %s <hash type> [options] [<file>...]\n"
+		"       %s -b\n"
 		"Options:\n"
 		"	-n		Print filename(s)\n"
 		"	-N		Suppress trailing newline\n"
+		"	-b		Benchmark all hash types\n"
 		"\n"
-		"Supported hash types:", progname);
+		"Supported hash types:", progname, progname);
 
 	for (i = 0; i < ARRAY_SIZE(types); i++)
 		fprintf(stderr, "%s %s", i ? "," : "", types[i].name);
@@ -772,53 +1356,15 @@ static struct hash_type *get_hash_type(const char *name)
 }
 
 
-static int hash_file(struct hash_type *t, const char *filename, bool add_filename,
-	bool no_newline)
-{
-	const char *str;
-
-	if (!filename || !strcmp(filename, "-")) {
-		str = t->func(stdin);
-	} else {
-		struct stat path_stat;
-		stat(filename, &path_stat);
-		if (S_ISDIR(path_stat.st_mode)) {
-			fprintf(stderr, "Failed to open '%s': Is a directory\n", filename);
-			return 1;
-		}
-
-		FILE *f = fopen(filename, "r");
-
-		if (!f) {
-			fprintf(stderr, "Failed to open '%s'\n", filename);
-			return 1;
-		}
-		str = t->func(f);
-		fclose(f);
-	}
-
-	if (!str) {
-		fprintf(stderr, "Failed to generate hash\n");
-		return 1;
-	}
-
-	if (add_filename)
-		printf("%s %s%s", str, filename ? filename : "-",
-			no_newline ? "" : "\n");
-	else
-		printf("%s%s", str, no_newline ? "" : "\n");
-	return 0;
-}
-
-
 int main(int argc, char **argv)
 {
 	struct hash_type *t;
 	const char *progname = argv[0];
-	int i, ch;
+	const char *in = NULL;
+	int ch;
 	bool add_filename = false, no_newline = false;
 
-	while ((ch = getopt(argc, argv, "nN")) != -1) {
+	while ((ch = getopt(argc, argv, "nNb")) != -1) {
 		switch (ch) {
 		case 'n':
 			add_filename = true;
@@ -826,6 +1372,8 @@ int main(int argc, char **argv)
 		case 'N':
 			no_newline = true;
 			break;
+		case 'b':
+			return hash_bench();
 		default:
 			return usage(progname);
 		}
@@ -842,13 +1390,8 @@ int main(int argc, char **argv)
 		return usage(progname);
 
 	if (argc < 2)
-		return hash_file(t, NULL, add_filename, no_newline);
+		return hash_files(t, &in, 1, add_filename, no_newline);
 
-	for (i = 0; i < argc - 1; i++) {
-		int ret = hash_file(t, argv[1 + i], add_filename, no_newline);
-		if (ret)
-			return ret;
-	}
-
-	return 0;
+	return hash_files(t, (const char **) argv + 1, argc - 1, add_filename,
+			  no_newline);
 }
@@ -0,0 +1,99 @@
+#!/bin/sh
+# Compare the tar handling of the NAND sysupgrade with and without nandtar
+# on a file-backed nandsim device.
+#
+# Needs root, the nandsim, ubi and mtd modules, mtd-utils and nandtar.
+#
+# Usage: nandtar-bench.sh <sysupgrade.tar[.gz]>
+
+set -e
+
+image="$1"
+[ -f "$image" ] || {
+	echo "Usage: $0 <sysupgrade.tar[.gz]>" >&2
+	exit 1
+}
+
+case "$(dd if="$image" bs=2 count=1 2>/dev/null | hexdump -v -n 2 -e '1/1 "%02x"')" in
+	1f8b) cmd=zcat;;
+	*) cmd=cat;;
+esac
+
+tmpdir="$(mktemp -d)"
+mtdnum=
+
+cleanup() {
+	[ -n "$mtdnum" ] && ubidetach -m "$mtdnum" >/dev/null 2>&1 || :
+	rmmod nandsim 2>/dev/null || :
+	rm -rf "$tmpdir"
+}
+trap cleanup EXIT
+
+# 256 MiB, 2 KiB pages, 128 KiB erase blocks, backed by a file
+modprobe nandsim first_id_byte=0x20 second_id_byte=0xaa third_id_byte=0x00 \
+	fourth_id_byte=0x15 cache_file="$tmpdir/nandsim.bin"
+mtdnum="$(grep -m 1 'NAND simulator' /proc/mtd | sed 's/^mtd\([0-9]*\):.*/\1/')"
+
+ubiformat -y -q "/dev/mtd$mtdnum"
+ubidev="ubi$(ubiattach -m "$mtdnum" | sed -n 's/.*UBI device number \([0-9]*\).*/\1/p')"
+
+board_dir="$($cmd < "$image" | tar tf - | grep -m 1 '^sysupgrade-.*/$')"
+board_dir="${board_dir%/}"
+
+mkvols() {
+	ubirmvol "/dev/$ubidev" -N kernel >/dev/null 2>&1 || :
+	ubirmvol "/dev/$ubidev" -N rootfs >/dev/null 2>&1 || :
+	ubimkvol "/dev/$ubidev" -N kernel -s "$1" >/dev/null
+	ubimkvol "/dev/$ubidev" -N rootfs -s "$2" >/dev/null
+}
+
+vol() {
+	local v
+
+	for v in /sys/class/ubi/${ubidev}_*; do
+		[ "$(cat "$v/name")" = "$1" ] && basename "$v"
+	done
+}
+
+now() {
+	cut -d' ' -f1 /proc/uptime
+}
+
+legacy() {
+	local kernel_length rootfs_length
+
+	$cmd < "$image" | tar xOf - > /dev/null
+	$cmd < "$image" | tar tf - | grep -m 1 '^sysupgrade-.*/$' > /dev/null
+	kernel_length=$($cmd < "$image" | tar xOf - "$board_dir/kernel" | wc -c)
+	rootfs_length=$($cmd < "$image" | tar xOf - "$board_dir/root" | wc -c)
+	$cmd < "$image" | tar xOf - "$board_dir/root" | dd bs=4 count=1 2>/dev/null > /dev/null
+
+	mkvols "$kernel_length" "$rootfs_length"
+	$cmd < "$image" | tar xOf - "$board_dir/root" | \
+		ubiupdatevol "/dev/$(vol rootfs)" -s "$rootfs_length" -
+	$cmd < "$image" | tar xOf - "$board_dir/kernel" | \
+		ubiupdatevol "/dev/$(vol kernel)" -s "$kernel_length" -
+}
+
+single() {
+	local index kernel_length rootfs_length
+
+	index="$($cmd < "$image" | nandtar list)"
+	kernel_length="$(echo "$index" | awk -v n="$board_dir/kernel" '$1 == n { print $2 }')"
+	rootfs_length="$(echo "$index" | awk -v n="$board_dir/root" '$1 == n { print $2 }')"
+
+	mkvols "$kernel_length" "$rootfs_length"
+	$cmd < "$image" | nandtar write \
+		"$board_dir/root" "ubiupdatevol /dev/$(vol rootfs) -s $rootfs_length -" \
+		"$board_dir/kernel" "ubiupdatevol /dev/$(vol kernel) -s $kernel_length -" \
+		> /dev/null
+}
+
+for run in legacy single; do
+	sync
+	echo 3 > /proc/sys/vm/drop_caches
+	start="$(now)"
+	$run
+	end="$(now)"
+	echo "$run: $(echo "$start $end" | awk '{ printf "%.2f", $2 - $1 }') s"
+done
@@ -30,13 +30,17 @@
 #include <linux/skbuff.h>
 #include <linux/dma-mapping.h>
 #include <linux/workqueue.h>
+#include <linux/hrtimer.h>
 #include <linux/reset.h>
 #include <linux/of.h>
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
+#include <linux/bpf.h>
 
 #include <linux/bitops.h>
 
+#include <net/xdp.h>
+
 #include <asm/mach-ath79/ar71xx_regs.h>
 #include <asm/mach-ath79/ath79.h>
 
@@ -68,6 +72,8 @@
 #define AG71XX_TX_RING_SIZE_MAX		256
 #define AG71XX_RX_RING_SIZE_MAX		256
 
+#define AG71XX_TX_COAL_USECS_MAX	10000
+
 #ifdef CONFIG_AG71XX_LEGACY_DEBUG
 #define DBG(fmt, args...)	pr_debug(fmt, ## args)
 #else
@@ -95,15 +101,20 @@ struct ag71xx_desc {
 #define AG71XX_DESC_SIZE	roundup(sizeof(struct ag71xx_desc), \
 					L1_CACHE_BYTES)
 
+#define AG71XX_BUF_SKB		0
+#define AG71XX_BUF_XDP		1
+
 struct ag71xx_buf {
 	union {
 		struct sk_buff	*skb;
+		struct xdp_frame *xdpf;
 		void		*rx_buf;
 	};
 	union {
 		dma_addr_t	dma_addr;
 		unsigned int		len;
 	};
+	u8			type;
 };
 
 struct ag71xx_ring {
@@ -137,6 +148,18 @@ struct ag71xx_napi_stats {
 
 	unsigned long		rx[AG71XX_NAPI_WEIGHT + 1];
 	unsigned long		tx[AG71XX_NAPI_WEIGHT + 1];
+
+	/* packets queued per TX DMA kick */
+	unsigned long		kick_count;
+	unsigned long		kick_packets;
+	unsigned long		kick_packets_max;
+	unsigned long		kick[AG71XX_NAPI_WEIGHT + 1];
+
+	/* descriptors reclaimed per TX completion run */
+	unsigned long		compl_count;
+	unsigned long		compl_descs;
+	unsigned long		compl_descs_max;
+	unsigned long		compl[AG71XX_NAPI_WEIGHT + 1];
 };
 
 struct ag71xx_debug {
@@ -154,18 +177,30 @@ struct ag71xx {
 	struct ag71xx_ring	rx_ring ____cacheline_aligned;
 	struct ag71xx_ring	tx_ring ____cacheline_aligned;
 
+	struct bpf_prog		*xdp_prog;
+	struct page_pool	*page_pool;
+
 	int			mac_idx;
 
 	u16			desc_pktlen_mask;
 	u16			rx_buf_size;
-	u8			rx_buf_offset;
+	u16			rx_buf_offset;
+	u32			rx_frag_size;
+	u8			rx_ip_align;
 	u8			tx_hang_workaround:1;
 	u8			builtin_switch:1;
 
+	/* packets queued since the last TX DMA kick */
+	unsigned int		tx_pending;
+	u32			tx_coal_usecs;
+	u32			tx_coal_frames;
+	struct hrtimer		tx_coal_timer;
+
 	struct net_device	*dev;
 	struct platform_device  *pdev;
 	spinlock_t		lock;
 	struct napi_struct	napi;
+	struct xdp_rxq_info	xdp_rxq;
 	u32			msg_enable;
 
 	/*
@@ -433,6 +468,8 @@ int ag71xx_debugfs_init(struct ag71xx *ag);
 void ag71xx_debugfs_exit(struct ag71xx *ag);
 void ag71xx_debugfs_update_int_stats(struct ag71xx *ag, u32 status);
 void ag71xx_debugfs_update_napi_stats(struct ag71xx *ag, int rx, int tx);
+void ag71xx_debugfs_update_kick_stats(struct ag71xx *ag, unsigned int packets);
+void ag71xx_debugfs_update_compl_stats(struct ag71xx *ag, unsigned int descs);
 #else
 static inline int ag71xx_debugfs_root_init(void) { return 0; }
 static inline void ag71xx_debugfs_root_exit(void) {}
@@ -442,6 +479,10 @@ static inline void ag71xx_debugfs_update_int_stats(struct ag71xx *ag,
 						   u32 status) {}
 static inline void ag71xx_debugfs_update_napi_stats(struct ag71xx *ag,
 						    int rx, int tx) {}
+static inline void ag71xx_debugfs_update_kick_stats(struct ag71xx *ag,
+						    unsigned int packets) {}
+static inline void ag71xx_debugfs_update_compl_stats(struct ag71xx *ag,
+						     unsigned int descs) {}
 #endif /* CONFIG_AG71XX_LEGACY_DEBUG_FS */
 
 int ag71xx_ar7240_init(struct ag71xx *ag, struct device_node *np);
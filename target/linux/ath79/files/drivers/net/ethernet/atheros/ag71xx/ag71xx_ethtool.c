@@ -143,6 +143,56 @@ ag71xx_ethtool_set_ringparam(struct net_device *dev,
 	return err;
 }
 
+static int
+ag71xx_ethtool_get_coalesce(struct net_device *dev,
+			    struct ethtool_coalesce *ec,
+			    struct kernel_ethtool_coalesce *kernel_coal,
+			    struct netlink_ext_ack *extack)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+
+	ec->tx_coalesce_usecs = ag->tx_coal_usecs;
+	ec->tx_max_coalesced_frames = ag->tx_coal_frames;
+
+	return 0;
+}
+
+static int
+ag71xx_ethtool_set_coalesce(struct net_device *dev,
+			    struct ethtool_coalesce *ec,
+			    struct kernel_ethtool_coalesce *kernel_coal,
+			    struct netlink_ext_ack *extack)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+	unsigned long flags;
+
+	if (ec->tx_coalesce_usecs > AG71XX_TX_COAL_USECS_MAX ||
+	    ec->tx_max_coalesced_frames > BIT(ag->tx_ring.order))
+		return -EINVAL;
+
+	spin_lock_irqsave(&ag->lock, flags);
+	ag->tx_coal_usecs = ec->tx_coalesce_usecs;
+	ag->tx_coal_frames = ec->tx_max_coalesced_frames;
+
+	/* NAPI re-enables interrupts on completion, only touch them when idle */
+	if (ag71xx_rr(ag, AG71XX_REG_INT_ENABLE) & AG71XX_INT_RX) {
+		if (ag->tx_coal_usecs)
+			ag71xx_int_disable(ag, AG71XX_INT_TX);
+		else
+			ag71xx_int_enable(ag, AG71XX_INT_TX);
+	}
+	spin_unlock_irqrestore(&ag->lock, flags);
+
+	/* reclaim anything queued before the change */
+	if (netif_running(dev)) {
+		local_bh_disable();
+		napi_schedule(&ag->napi);
+		local_bh_enable();
+	}
+
+	return 0;
+}
+
 static int ag71xx_ethtool_nway_reset(struct net_device *dev)
 {
 	struct ag71xx *ag = netdev_priv(dev);
@@ -184,10 +234,14 @@ static int ag71xx_ethtool_get_sset_count(struct net_device *ndev, int sset)
 }
 
 struct ethtool_ops ag71xx_ethtool_ops = {
+	.supported_coalesce_params = ETHTOOL_COALESCE_TX_USECS |
+				     ETHTOOL_COALESCE_TX_MAX_FRAMES,
 	.get_msglevel	= ag71xx_ethtool_get_msglevel,
 	.set_msglevel	= ag71xx_ethtool_set_msglevel,
 	.get_ringparam	= ag71xx_ethtool_get_ringparam,
 	.set_ringparam	= ag71xx_ethtool_set_ringparam,
+	.get_coalesce	= ag71xx_ethtool_get_coalesce,
+	.set_coalesce	= ag71xx_ethtool_set_coalesce,
 	.get_link_ksettings = phy_ethtool_get_link_ksettings,
 	.set_link_ksettings = phy_ethtool_set_link_ksettings,
 	.get_link	= ethtool_op_get_link,
@@ -94,6 +94,38 @@ void ag71xx_debugfs_update_napi_stats(struct ag71xx *ag, int rx, int tx)
 	}
 }
 
+static void ag71xx_debugfs_hist_add(unsigned long *hist, unsigned long *max,
+				    unsigned int val)
+{
+	hist[min_t(unsigned int, val, AG71XX_NAPI_WEIGHT)]++;
+	if (val > *max)
+		*max = val;
+}
+
+void ag71xx_debugfs_update_kick_stats(struct ag71xx *ag, unsigned int packets)
+{
+	struct ag71xx_napi_stats *stats = &ag->debug.napi_stats;
+
+	if (!packets)
+		return;
+
+	stats->kick_count++;
+	stats->kick_packets += packets;
+	ag71xx_debugfs_hist_add(stats->kick, &stats->kick_packets_max, packets);
+}
+
+void ag71xx_debugfs_update_compl_stats(struct ag71xx *ag, unsigned int descs)
+{
+	struct ag71xx_napi_stats *stats = &ag->debug.napi_stats;
+
+	if (!descs)
+		return;
+
+	stats->compl_count++;
+	stats->compl_descs += descs;
+	ag71xx_debugfs_hist_add(stats->compl, &stats->compl_descs_max, descs);
+}
+
 static ssize_t read_file_napi_stats(struct file *file, char __user *user_buf,
 				    size_t count, loff_t *ppos)
 {
@@ -104,10 +136,12 @@ static ssize_t read_file_napi_stats(struct file *file, char __user *user_buf,
 	unsigned int len = 0;
 	unsigned long rx_avg = 0;
 	unsigned long tx_avg = 0;
+	unsigned long kick_avg = 0;
+	unsigned long compl_avg = 0;
 	int ret;
 	int i;
 
-	buflen = 2048;
+	buflen = 4096;
 	buf = kmalloc(buflen, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
@@ -118,24 +152,34 @@ static ssize_t read_file_napi_stats(struct file *file, char __user *user_buf,
 	if (stats->tx_count)
 		tx_avg = stats->tx_packets / stats->tx_count;
 
-	len += snprintf(buf + len, buflen - len, "%3s  %10s %10s\n",
-			"len", "rx", "tx");
+	if (stats->kick_count)
+		kick_avg = stats->kick_packets / stats->kick_count;
+
+	if (stats->compl_count)
+		compl_avg = stats->compl_descs / stats->compl_count;
+
+	len += snprintf(buf + len, buflen - len, "%3s  %10s %10s %10s %10s\n",
+			"len", "rx", "tx", "tx_kick", "tx_compl");
 
 	for (i = 1; i <= AG71XX_NAPI_WEIGHT; i++)
 		len += snprintf(buf + len, buflen - len,
-				"%3d: %10lu %10lu\n",
-				i, stats->rx[i], stats->tx[i]);
+				"%3d: %10lu %10lu %10lu %10lu\n",
+				i, stats->rx[i], stats->tx[i],
+				stats->kick[i], stats->compl[i]);
 
 	len += snprintf(buf + len, buflen - len, "\n");
 
-	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu\n",
-			"sum", stats->rx_count, stats->tx_count);
-	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu\n",
-			"avg", rx_avg, tx_avg);
-	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu\n",
-			"max", stats->rx_packets_max, stats->tx_packets_max);
-	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu\n",
-			"pkt", stats->rx_packets, stats->tx_packets);
+	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu %10lu %10lu\n",
+			"sum", stats->rx_count, stats->tx_count,
+			stats->kick_count, stats->compl_count);
+	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu %10lu %10lu\n",
+			"avg", rx_avg, tx_avg, kick_avg, compl_avg);
+	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu %10lu %10lu\n",
+			"max", stats->rx_packets_max, stats->tx_packets_max,
+			stats->kick_packets_max, stats->compl_descs_max);
+	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu %10lu %10lu\n",
+			"pkt", stats->rx_packets, stats->tx_packets,
+			stats->kick_packets, stats->compl_descs);
 
 	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
 	kfree(buf);
@@ -16,6 +16,8 @@
 #include <linux/of_address.h>
 #include <linux/of_platform.h>
 #include <linux/version.h>
+#include <linux/bpf_trace.h>
+#include <net/page_pool/helpers.h>
 #include "ag71xx.h"
 
 #define AG71XX_DEFAULT_MSG_ENABLE	\
@@ -112,7 +114,9 @@ static void ag71xx_ring_tx_clean(struct ag71xx *ag)
 			dev->stats.tx_errors++;
 		}
 
-		if (ring->buf[i].skb) {
+		if (ring->buf[i].skb && ring->buf[i].type == AG71XX_BUF_XDP) {
+			xdp_return_frame(ring->buf[i].xdpf);
+		} else if (ring->buf[i].skb) {
 			bytes_compl += ring->buf[i].len;
 			pkts_compl++;
 			dev_kfree_skb_any(ring->buf[i].skb);
@@ -149,6 +153,7 @@ static void ag71xx_ring_tx_init(struct ag71xx *ag)
 
 	ring->curr = 0;
 	ring->dirty = 0;
+	ag->tx_pending = 0;
 	netdev_reset_queue(ag->dev);
 }
 
@@ -163,9 +168,10 @@ static void ag71xx_ring_rx_clean(struct ag71xx *ag)
 
 	for (i = 0; i < ring_size; i++)
 		if (ring->buf[i].rx_buf) {
-			dma_unmap_single(&ag->pdev->dev, ring->buf[i].dma_addr,
-					 ag->rx_buf_size, DMA_FROM_DEVICE);
-			skb_free_frag(ring->buf[i].rx_buf);
+			page_pool_put_full_page(ag->page_pool,
+						virt_to_head_page(ring->buf[i].rx_buf),
+						false);
+			ring->buf[i].rx_buf = NULL;
 		}
 }
 
@@ -176,20 +182,18 @@ static int ag71xx_buffer_size(struct ag71xx *ag)
 }
 
 static bool ag71xx_fill_rx_buf(struct ag71xx *ag, struct ag71xx_buf *buf,
-			       int offset,
-			       void *(*alloc)(unsigned int size))
+			       int offset)
 {
 	struct ag71xx_ring *ring = &ag->rx_ring;
 	struct ag71xx_desc *desc = ag71xx_ring_desc(ring, buf - &ring->buf[0]);
-	void *data;
+	struct page *page;
 
-	data = alloc(ag71xx_buffer_size(ag));
-	if (!data)
+	page = page_pool_dev_alloc_pages(ag->page_pool);
+	if (!page)
 		return false;
 
-	buf->rx_buf = data;
-	buf->dma_addr = dma_map_single(&ag->pdev->dev, data, ag->rx_buf_size,
-				       DMA_FROM_DEVICE);
+	buf->rx_buf = page_address(page);
+	buf->dma_addr = page_pool_get_dma_addr(page);
 	desc->data = (u32) buf->dma_addr + offset;
 	return true;
 }
@@ -216,8 +220,7 @@ static int ag71xx_ring_rx_init(struct ag71xx *ag)
 	for (i = 0; i < ring_size; i++) {
 		struct ag71xx_desc *desc = ag71xx_ring_desc(ring, i);
 
-		if (!ag71xx_fill_rx_buf(ag, &ring->buf[i], ag->rx_buf_offset,
-					netdev_alloc_frag)) {
+		if (!ag71xx_fill_rx_buf(ag, &ring->buf[i], ag->rx_buf_offset)) {
 			ret = -ENOMEM;
 			break;
 		}
@@ -250,8 +253,7 @@ static int ag71xx_ring_rx_refill(struct ag71xx *ag)
 		desc = ag71xx_ring_desc(ring, i);
 
 		if (!ring->buf[i].rx_buf &&
-		    !ag71xx_fill_rx_buf(ag, &ring->buf[i], offset,
-					napi_alloc_frag))
+		    !ag71xx_fill_rx_buf(ag, &ring->buf[i], offset))
 			break;
 
 		desc->ctrl = DESC_EMPTY;
@@ -266,23 +268,88 @@ static int ag71xx_ring_rx_refill(struct ag71xx *ag)
 	return count;
 }
 
+static unsigned int ag71xx_rx_headroom(struct ag71xx *ag)
+{
+	return (ag->xdp_prog ? XDP_PACKET_HEADROOM : NET_SKB_PAD) +
+	       ag->rx_ip_align;
+}
+
+static int ag71xx_page_pool_init(struct ag71xx *ag)
+{
+	struct page_pool_params pp_params = {
+		.order = get_order(ag71xx_buffer_size(ag)),
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = BIT(ag->rx_ring.order),
+		.nid = NUMA_NO_NODE,
+		.dev = &ag->pdev->dev,
+		/* XDP_TX transmits straight out of the RX buffers */
+		.dma_dir = ag->xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE,
+		.offset = ag->rx_buf_offset,
+		.max_len = ag->rx_buf_size - ag->rx_buf_offset,
+	};
+	struct page_pool *pp;
+	int err;
+
+	pp = page_pool_create(&pp_params);
+	if (IS_ERR(pp))
+		return PTR_ERR(pp);
+
+	err = xdp_rxq_info_reg(&ag->xdp_rxq, ag->dev, 0, ag->napi.napi_id);
+	if (err)
+		goto err_destroy;
+
+	err = xdp_rxq_info_reg_mem_model(&ag->xdp_rxq, MEM_TYPE_PAGE_POOL, pp);
+	if (err)
+		goto err_unreg;
+
+	ag->page_pool = pp;
+	ag->rx_frag_size = PAGE_SIZE << pp_params.order;
+
+	return 0;
+
+err_unreg:
+	xdp_rxq_info_unreg(&ag->xdp_rxq);
+err_destroy:
+	page_pool_destroy(pp);
+	return err;
+}
+
+static void ag71xx_page_pool_free(struct ag71xx *ag)
+{
+	if (!ag->page_pool)
+		return;
+
+	xdp_rxq_info_unreg(&ag->xdp_rxq);
+	page_pool_destroy(ag->page_pool);
+	ag->page_pool = NULL;
+}
+
 static int ag71xx_rings_init(struct ag71xx *ag)
 {
 	struct ag71xx_ring *tx = &ag->tx_ring;
 	struct ag71xx_ring *rx = &ag->rx_ring;
 	int ring_size = BIT(tx->order) + BIT(rx->order);
 	int tx_size = BIT(tx->order);
+	int ret;
+
+	ag->rx_buf_offset = ag71xx_rx_headroom(ag);
+	ag->rx_buf_size = SKB_DATA_ALIGN(ag71xx_max_frame_len(ag->dev->mtu) +
+					 ag->rx_buf_offset);
+
+	ret = ag71xx_page_pool_init(ag);
+	if (ret)
+		return ret;
 
 	tx->buf = kzalloc(ring_size * sizeof(*tx->buf), GFP_KERNEL);
 	if (!tx->buf)
-		return -ENOMEM;
+		goto err_pool;
 
 	tx->descs_cpu = dma_alloc_coherent(&ag->pdev->dev, ring_size * AG71XX_DESC_SIZE,
 					   &tx->descs_dma, GFP_KERNEL);
 	if (!tx->descs_cpu) {
 		kfree(tx->buf);
 		tx->buf = NULL;
-		return -ENOMEM;
+		goto err_pool;
 	}
 
 	rx->buf = &tx->buf[tx_size];
@@ -291,6 +358,10 @@ static int ag71xx_rings_init(struct ag71xx *ag)
 
 	ag71xx_ring_tx_init(ag);
 	return ag71xx_ring_rx_init(ag);
+
+err_pool:
+	ag71xx_page_pool_free(ag);
+	return -ENOMEM;
 }
 
 static void ag71xx_rings_free(struct ag71xx *ag)
@@ -316,6 +387,7 @@ static void ag71xx_rings_cleanup(struct ag71xx *ag)
 	ag71xx_ring_rx_clean(ag);
 	ag71xx_ring_tx_clean(ag);
 	ag71xx_rings_free(ag);
+	ag71xx_page_pool_free(ag);
 
 	netdev_reset_queue(ag->dev);
 }
@@ -490,6 +562,7 @@ static void ag71xx_fast_reset(struct ag71xx *ag)
 	ag71xx_hw_setup(ag);
 	ag->tx_ring.curr = 0;
 	ag->tx_ring.dirty = 0;
+	ag->tx_pending = 0;
 	netdev_reset_queue(ag->dev);
 
 	/* setup max frame length */
@@ -996,6 +1069,7 @@ static void ag71xx_hw_disable(struct ag71xx *ag)
 	ag71xx_dma_reset(ag);
 
 	napi_disable(&ag->napi);
+	hrtimer_cancel(&ag->tx_coal_timer);
 #if LINUX_VERSION_CODE < KERNEL_VERSION(6,16,0)
 	del_timer_sync(&ag->oom_timer);
 #else
@@ -1013,7 +1087,6 @@ static int ag71xx_open(struct net_device *dev)
 
 	netif_carrier_off(dev);
 	max_frame_len = ag71xx_max_frame_len(dev->mtu);
-	ag->rx_buf_size = SKB_DATA_ALIGN(max_frame_len + NET_SKB_PAD + NET_IP_ALIGN);
 
 	/* setup max frame length */
 	ag71xx_wr(ag, AG71XX_REG_MAC_MFL, max_frame_len);
@@ -1101,6 +1174,45 @@ static int ag71xx_fill_dma_desc(struct ag71xx_ring *ring, u32 addr, int len)
 	return ndesc;
 }
 
+/* Must be called with the tx queue lock held */
+static void ag71xx_tx_kick(struct ag71xx *ag)
+{
+	struct ag71xx_ring *ring = &ag->tx_ring;
+
+	/* flush descriptors */
+	wmb();
+
+	/* enable TX engine */
+	ag71xx_wr(ag, AG71XX_REG_TX_CTRL, TX_CTRL_TXE);
+
+	ag71xx_debugfs_update_kick_stats(ag, ag->tx_pending);
+	ag->tx_pending = 0;
+
+	if (!ag->tx_coal_usecs)
+		return;
+
+	/*
+	 * The TX completion interrupt is masked while coalescing, reclaim
+	 * early once enough frames are in flight, otherwise on the timer.
+	 */
+	if (ag->tx_coal_frames &&
+	    ring->curr - ring->dirty >= ag->tx_coal_frames)
+		napi_schedule(&ag->napi);
+	else if (!hrtimer_active(&ag->tx_coal_timer))
+		hrtimer_start(&ag->tx_coal_timer,
+			      ns_to_ktime(ag->tx_coal_usecs * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+}
+
+static enum hrtimer_restart ag71xx_tx_coal_timer(struct hrtimer *timer)
+{
+	struct ag71xx *ag = container_of(timer, struct ag71xx, tx_coal_timer);
+
+	napi_schedule(&ag->napi);
+
+	return HRTIMER_NORESTART;
+}
+
 static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 					  struct net_device *dev)
 {
@@ -1111,6 +1223,7 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 	struct ag71xx_desc *desc;
 	dma_addr_t dma_addr;
 	int i, n, ring_min;
+	bool kick;
 
 	if (skb->len <= 4) {
 		DBG("%s: packet len is too small\n", ag->dev->name);
@@ -1131,16 +1244,18 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 	i = (ring->curr + n - 1) & ring_mask;
 	ring->buf[i].len = skb->len;
 	ring->buf[i].skb = skb;
+	ring->buf[i].type = AG71XX_BUF_SKB;
 
-	netdev_sent_queue(dev, skb->len);
+	kick = __netdev_sent_queue(dev, skb->len, netdev_xmit_more());
 
 	skb_tx_timestamp(skb);
 
+	/* descriptor fields must be visible before handing it over */
+	dma_wmb();
+
 	desc->ctrl &= ~DESC_EMPTY;
 	ring->curr += n;
-
-	/* flush descriptor */
-	wmb();
+	ag->tx_pending++;
 
 	ring_min = 2;
 	if (ring->desc_split)
@@ -1149,12 +1264,14 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 	if (ring->curr - ring->dirty >= ring_size - ring_min) {
 		DBG("%s: tx queue full\n", dev->name);
 		netif_stop_queue(dev);
+		kick = true;
 	}
 
 	DBG("%s: packet injected into TX queue\n", ag->dev->name);
 
-	/* enable TX engine */
-	ag71xx_wr(ag, AG71XX_REG_TX_CTRL, TX_CTRL_TXE);
+	/* defer the kick while the stack has more packets for us */
+	if (kick)
+		ag71xx_tx_kick(ag);
 
 	return NETDEV_TX_OK;
 
@@ -1164,10 +1281,130 @@ err_drop_unmap:
 err_drop:
 	dev->stats.tx_dropped++;
 
+	/* don't strand packets queued by earlier xmit_more calls */
+	if (ag->tx_pending && !netdev_xmit_more())
+		ag71xx_tx_kick(ag);
+
 	dev_kfree_skb(skb);
 	return NETDEV_TX_OK;
 }
 
+static int ag71xx_xdp_xmit_frame(struct ag71xx *ag, struct xdp_frame *xdpf,
+				 bool dma_map)
+{
+	struct ag71xx_ring *ring = &ag->tx_ring;
+	int ring_mask = BIT(ring->order) - 1;
+	int ring_size = BIT(ring->order);
+	struct device *dev = &ag->pdev->dev;
+	struct ag71xx_desc *desc;
+	dma_addr_t dma_addr;
+	int i, n, ring_min;
+
+	if (xdpf->len <= 4)
+		return -EINVAL;
+
+	if (dma_map) {
+		dma_addr = dma_map_single(dev, xdpf->data, xdpf->len,
+					  DMA_TO_DEVICE);
+		if (dma_mapping_error(dev, dma_addr))
+			return -ENOMEM;
+	} else {
+		/* XDP_TX, the frame is still in one of our RX pages */
+		struct page *page = virt_to_head_page(xdpf->data);
+
+		dma_addr = page_pool_get_dma_addr(page) +
+			   (xdpf->data - page_address(page));
+		dma_sync_single_for_device(dev, dma_addr, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+	}
+
+	i = ring->curr & ring_mask;
+	desc = ag71xx_ring_desc(ring, i);
+
+	n = ag71xx_fill_dma_desc(ring, (u32) dma_addr,
+				 xdpf->len & ag->desc_pktlen_mask);
+	if (n < 0) {
+		if (dma_map)
+			dma_unmap_single(dev, dma_addr, xdpf->len,
+					 DMA_TO_DEVICE);
+		return -ENOSPC;
+	}
+
+	i = (ring->curr + n - 1) & ring_mask;
+	ring->buf[i].len = xdpf->len;
+	ring->buf[i].xdpf = xdpf;
+	ring->buf[i].type = AG71XX_BUF_XDP;
+
+	dma_wmb();
+
+	desc->ctrl &= ~DESC_EMPTY;
+	ring->curr += n;
+	ag->tx_pending++;
+
+	ring_min = 2;
+	if (ring->desc_split)
+	    ring_min *= AG71XX_TX_RING_DS_PER_PKT;
+
+	if (ring->curr - ring->dirty >= ring_size - ring_min)
+		netif_stop_queue(ag->dev);
+
+	return 0;
+}
+
+/* The TX ring is shared with the stack, serialize on its queue lock */
+static int ag71xx_xdp_xmit_tx(struct ag71xx *ag, struct xdp_frame *xdpf)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(ag->dev, 0);
+	int ret;
+
+	__netif_tx_lock(txq, smp_processor_id());
+	ret = ag71xx_xdp_xmit_frame(ag, xdpf, false);
+	if (!ret)
+		txq_trans_cond_update(txq);
+	__netif_tx_unlock(txq);
+
+	return ret;
+}
+
+static int ag71xx_xdp_xmit(struct net_device *dev, int n,
+			   struct xdp_frame **frames, u32 flags)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+	struct netdev_queue *txq;
+	int i, nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev)))
+		return -ENETDOWN;
+
+	txq = netdev_get_tx_queue(dev, 0);
+	__netif_tx_lock(txq, smp_processor_id());
+
+	/* stopped while the ring is full or being re-initialized */
+	if (unlikely(netif_tx_queue_stopped(txq))) {
+		__netif_tx_unlock(txq);
+		return 0;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (ag71xx_xdp_xmit_frame(ag, frames[i], true))
+			break;
+		nxmit++;
+	}
+
+	if (nxmit) {
+		txq_trans_cond_update(txq);
+		if (flags & XDP_XMIT_FLUSH)
+			ag71xx_tx_kick(ag);
+	}
+
+	__netif_tx_unlock(txq);
+
+	return nxmit;
+}
+
 static int ag71xx_do_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 {
 	struct ag71xx *ag = netdev_priv(dev);
@@ -1244,6 +1481,9 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	int ring_size = BIT(ring->order);
 	int sent = 0;
 	int bytes_compl = 0;
+	int bql_sent = 0;
+	int bql_bytes = 0;
+	int descs = 0;
 	int n = 0;
 
 	DBG("%s: processing TX ring\n", ag->dev->name);
@@ -1269,18 +1509,21 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 		if (!skb)
 			continue;
 
-		napi_consume_skb(skb, budget);
+		if (ring->buf[i].type == AG71XX_BUF_XDP) {
+			xdp_return_frame(ring->buf[i].xdpf);
+		} else {
+			napi_consume_skb(skb, budget);
+			bql_bytes += ring->buf[i].len;
+			bql_sent++;
+		}
 		ring->buf[i].skb = NULL;
 
 		bytes_compl += ring->buf[i].len;
 
 		sent++;
 		ring->dirty += n;
-
-		while (n > 0) {
-			ag71xx_wr(ag, AG71XX_REG_TX_STATUS, TX_STATUS_PS);
-			n--;
-		}
+		descs += n;
+		n = 0;
 	}
 
 	DBG("%s: %d packets sent out\n", ag->dev->name, sent);
@@ -1288,10 +1531,20 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	if (!sent)
 		return 0;
 
+	/*
+	 * Each write acknowledges one descriptor, post them back to back
+	 * and flush only once instead of reading back after every write.
+	 */
+	for (n = 0; n < descs; n++)
+		__raw_writel(TX_STATUS_PS, ag->mac_base + AG71XX_REG_TX_STATUS);
+	(void) ag71xx_rr(ag, AG71XX_REG_TX_STATUS);
+
+	ag71xx_debugfs_update_compl_stats(ag, descs);
+
 	ag->dev->stats.tx_bytes += bytes_compl;
 	ag->dev->stats.tx_packets += sent;
 
-	netdev_completed_queue(ag->dev, sent, bytes_compl);
+	netdev_completed_queue(ag->dev, bql_sent, bql_bytes);
 	if ((ring->curr - ring->dirty) < (ring_size * 3) / 4)
 		netif_wake_queue(ag->dev);
 
@@ -1301,25 +1554,68 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	return sent;
 }
 
+static u32 ag71xx_run_xdp(struct ag71xx *ag, struct bpf_prog *prog,
+			  struct xdp_buff *xdp)
+{
+	struct net_device *dev = ag->dev;
+	struct xdp_frame *xdpf;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return act;
+	case XDP_TX:
+		xdpf = xdp_convert_buff_to_frame(xdp);
+		if (unlikely(!xdpf) || ag71xx_xdp_xmit_tx(ag, xdpf))
+			goto out_failure;
+		return act;
+	case XDP_REDIRECT:
+		if (unlikely(xdp_do_redirect(dev, xdp, prog)))
+			goto out_failure;
+		return act;
+	default:
+		bpf_warn_invalid_xdp_action(dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(dev, prog, act);
+		dev->stats.rx_dropped++;
+		fallthrough;
+	case XDP_DROP:
+		page_pool_recycle_direct(ag->page_pool,
+					 virt_to_head_page(xdp->data));
+		return XDP_DROP;
+	}
+}
+
 static int ag71xx_rx_packets(struct ag71xx *ag, int limit)
 {
 	struct net_device *dev = ag->dev;
 	struct ag71xx_ring *ring = &ag->rx_ring;
+	struct page_pool *pp = ag->page_pool;
+	struct bpf_prog *prog = READ_ONCE(ag->xdp_prog);
 	unsigned int pktlen_mask = ag->desc_pktlen_mask;
 	unsigned int offset = ag->rx_buf_offset;
 	int ring_mask = BIT(ring->order) - 1;
 	int ring_size = BIT(ring->order);
 	struct list_head rx_list;
 	struct sk_buff *skb;
+	struct xdp_buff xdp;
+	bool xdp_redirect = false;
+	bool xdp_tx = false;
 	int done = 0;
 
 	DBG("%s: rx packets, limit=%d, curr=%u, dirty=%u\n",
 			dev->name, limit, ring->curr, ring->dirty);
 	INIT_LIST_HEAD(&rx_list);
+	xdp_init_buff(&xdp, ag->rx_frag_size, &ag->xdp_rxq);
 
 	while (done < limit) {
 		unsigned int i = ring->curr & ring_mask;
 		struct ag71xx_desc *desc = ag71xx_ring_desc(ring, i);
+		unsigned int headroom = offset;
+		void *data;
 		int pktlen;
 		int err = 0;
 
@@ -1336,19 +1632,39 @@ static int ag71xx_rx_packets(struct ag71xx *ag, int limit)
 		pktlen = desc->ctrl & pktlen_mask;
 		pktlen -= ETH_FCS_LEN;
 
-		dma_unmap_single(&ag->pdev->dev, ring->buf[i].dma_addr,
-				 ag->rx_buf_size, DMA_FROM_DEVICE);
+		data = ring->buf[i].rx_buf;
+		dma_sync_single_for_cpu(&ag->pdev->dev,
+					ring->buf[i].dma_addr + offset, pktlen,
+					page_pool_get_dma_dir(pp));
 
 		dev->stats.rx_packets++;
 		dev->stats.rx_bytes += pktlen;
 
-		skb = napi_build_skb(ring->buf[i].rx_buf, ag71xx_buffer_size(ag));
+		if (prog) {
+			u32 act;
+
+			xdp_prepare_buff(&xdp, data, offset, pktlen, false);
+			act = ag71xx_run_xdp(ag, prog, &xdp);
+			if (act == XDP_REDIRECT)
+				xdp_redirect = true;
+			else if (act == XDP_TX)
+				xdp_tx = true;
+			if (act != XDP_PASS)
+				goto next;
+
+			/* the program may have moved the packet boundaries */
+			headroom = xdp.data - xdp.data_hard_start;
+			pktlen = xdp.data_end - xdp.data;
+		}
+
+		skb = napi_build_skb(data, ag->rx_frag_size);
 		if (!skb) {
-			skb_free_frag(ring->buf[i].rx_buf);
+			page_pool_recycle_direct(pp, virt_to_head_page(data));
 			goto next;
 		}
 
-		skb_reserve(skb, offset);
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, headroom);
 		skb_put(skb, pktlen);
 
 		if (err) {
@@ -1367,6 +1683,17 @@ next:
 		ring->curr++;
 	}
 
+	if (xdp_tx) {
+		struct netdev_queue *txq = netdev_get_tx_queue(dev, 0);
+
+		__netif_tx_lock(txq, smp_processor_id());
+		ag71xx_tx_kick(ag);
+		__netif_tx_unlock(txq);
+	}
+
+	if (xdp_redirect)
+		xdp_do_flush();
+
 	ag71xx_ring_rx_refill(ag);
 
 	list_for_each_entry(skb, &rx_list, list)
@@ -1422,10 +1749,18 @@ static int ag71xx_poll(struct napi_struct *napi, int limit)
 
 		napi_complete(napi);
 
-		/* enable interrupts */
+		/* enable interrupts, TX completions are timer driven when coalescing */
 		spin_lock_irqsave(&ag->lock, flags);
-		ag71xx_int_enable(ag, AG71XX_INT_POLL);
+		ag71xx_int_enable(ag, ag->tx_coal_usecs ? AG71XX_INT_RX :
+							  AG71XX_INT_POLL);
 		spin_unlock_irqrestore(&ag->lock, flags);
+
+		/* reclaim frames still in flight, the queue may be stopped */
+		if (ag->tx_coal_usecs && ag->tx_ring.curr != ag->tx_ring.dirty &&
+		    !hrtimer_active(&ag->tx_coal_timer))
+			hrtimer_start(&ag->tx_coal_timer,
+				      ns_to_ktime(ag->tx_coal_usecs * NSEC_PER_USEC),
+				      HRTIMER_MODE_REL);
 		return rx_done;
 	}
 
@@ -1477,10 +1812,20 @@ static irqreturn_t ag71xx_interrupt(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+static bool ag71xx_xdp_mtu_valid(int mtu)
+{
+	return SKB_DATA_ALIGN(ag71xx_max_frame_len(mtu) + XDP_PACKET_HEADROOM +
+			      NET_IP_ALIGN) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) <= PAGE_SIZE;
+}
+
 static int ag71xx_change_mtu(struct net_device *dev, int new_mtu)
 {
 	struct ag71xx *ag = netdev_priv(dev);
 
+	if (ag->xdp_prog && !ag71xx_xdp_mtu_valid(new_mtu))
+		return -EINVAL;
+
 	dev->mtu = new_mtu;
 	ag71xx_wr(ag, AG71XX_REG_MAC_MFL,
 		  ag71xx_max_frame_len(dev->mtu));
@@ -1488,6 +1833,61 @@ static int ag71xx_change_mtu(struct net_device *dev, int new_mtu)
 	return 0;
 }
 
+static int ag71xx_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			    struct netlink_ext_ack *extack)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+	bool reset;
+
+	if (prog && !ag71xx_xdp_mtu_valid(dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* RX headroom and DMA direction depend on XDP being enabled */
+	reset = netif_running(dev) && !!ag->xdp_prog != !!prog;
+	if (reset) {
+		/* keep ndo_xdp_xmit from other devices off the rings */
+		netif_tx_disable(dev);
+		synchronize_net();
+		ag71xx_hw_disable(ag);
+	}
+
+	old_prog = xchg(&ag->xdp_prog, prog);
+
+	if (reset) {
+		int ret = ag71xx_hw_enable(ag);
+
+		if (ret) {
+			/* the caller drops prog on error, restart with the old one */
+			ag71xx_rings_cleanup(ag);
+			xchg(&ag->xdp_prog, old_prog);
+			if (!ag71xx_hw_enable(ag) && ag->link)
+				__ag71xx_link_adjust(ag, false);
+			return ret;
+		}
+
+		if (ag->link)
+			__ag71xx_link_adjust(ag, false);
+	}
+
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int ag71xx_bpf(struct net_device *dev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return ag71xx_xdp_setup(dev, bpf->prog, bpf->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
 static const struct net_device_ops ag71xx_netdev_ops = {
 	.ndo_open		= ag71xx_open,
 	.ndo_stop		= ag71xx_stop,
@@ -1497,6 +1897,8 @@ static const struct net_device_ops ag71xx_netdev_ops = {
 	.ndo_change_mtu		= ag71xx_change_mtu,
 	.ndo_set_mac_address	= eth_mac_addr,
 	.ndo_validate_addr	= eth_validate_addr,
+	.ndo_bpf		= ag71xx_bpf,
+	.ndo_xdp_xmit		= ag71xx_xdp_xmit,
 };
 
 static int ag71xx_probe(struct platform_device *pdev)
@@ -1605,10 +2007,19 @@ static int ag71xx_probe(struct platform_device *pdev)
 
 	dev->netdev_ops = &ag71xx_netdev_ops;
 	dev->ethtool_ops = &ag71xx_ethtool_ops;
+	dev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT |
+			    NETDEV_XDP_ACT_NDO_XMIT;
 
 	INIT_DELAYED_WORK(&ag->restart_work, ag71xx_restart_work_func);
 
 	timer_setup(&ag->oom_timer, ag71xx_oom_timer_handler, 0);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,13,0)
+	hrtimer_init(&ag->tx_coal_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ag->tx_coal_timer.function = ag71xx_tx_coal_timer;
+#else
+	hrtimer_setup(&ag->tx_coal_timer, ag71xx_tx_coal_timer,
+		      CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+#endif
 
 	tx_size = AG71XX_TX_RING_SIZE_DEFAULT;
 	ag->rx_ring.order = ag71xx_ring_size_order(AG71XX_RX_RING_SIZE_DEFAULT);
@@ -1641,10 +2052,9 @@ static int ag71xx_probe(struct platform_device *pdev)
 	    of_device_is_compatible(np, "qca,qca9560-eth"))
 		ag->tx_hang_workaround = 1;
 
-	ag->rx_buf_offset = NET_SKB_PAD;
 	if (!of_device_is_compatible(np, "qca,ar7100-eth") &&
 	    !of_device_is_compatible(np, "qca,ar9130-eth"))
-		ag->rx_buf_offset += NET_IP_ALIGN;
+		ag->rx_ip_align = NET_IP_ALIGN;
 
 	if (of_device_is_compatible(np, "qca,ar7100-eth")) {
 		ag->tx_ring.desc_split = AG71XX_TX_RING_SPLIT;
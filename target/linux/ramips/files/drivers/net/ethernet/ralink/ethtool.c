@@ -21,6 +21,12 @@ FE_STAT_REG_DECLARE
 #undef _FE
 };
 
+static const char fe_rx_ring_str[][ETH_GSTRING_LEN] = {
+#define _FE(x...)	"rx0_" # x,
+FE_RX_RING_STAT_DECLARE
+#undef _FE
+};
+
 static int fe_get_link_ksettings(struct net_device *ndev,
 			   struct ethtool_link_ksettings *cmd)
 {
@@ -69,14 +75,14 @@ static void fe_get_drvinfo(struct net_device *dev,
 			   struct ethtool_drvinfo *info)
 {
 	struct fe_priv *priv = netdev_priv(dev);
-	struct fe_soc_data *soc = priv->soc;
 
 	strscpy(info->driver, priv->dev->driver->name, sizeof(info->driver));
 	strscpy(info->version, MTK_FE_DRV_VERSION, sizeof(info->version));
 	strscpy(info->bus_info, dev_name(priv->dev), sizeof(info->bus_info));
 
-	if (soc->reg_table[FE_REG_FE_COUNTER_BASE])
-		info->n_stats = ARRAY_SIZE(fe_gdma_str);
+	info->n_stats = ARRAY_SIZE(fe_rx_ring_str);
+	if (priv->hw_stats)
+		info->n_stats += ARRAY_SIZE(fe_gdma_str);
 }
 
 static u32 fe_get_msglevel(struct net_device *dev)
@@ -164,23 +170,53 @@ static void fe_get_ringparam(struct net_device *dev,
 
 static void fe_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 {
+	struct fe_priv *priv = netdev_priv(dev);
+	int i;
+
 	switch (stringset) {
 	case ETH_SS_STATS:
-		ethtool_puts(&data, *fe_gdma_str);
+		if (priv->hw_stats)
+			for (i = 0; i < ARRAY_SIZE(fe_gdma_str); i++)
+				ethtool_puts(&data, fe_gdma_str[i]);
+		for (i = 0; i < ARRAY_SIZE(fe_rx_ring_str); i++)
+			ethtool_puts(&data, fe_rx_ring_str[i]);
 		break;
 	}
 }
 
 static int fe_get_sset_count(struct net_device *dev, int sset)
 {
+	struct fe_priv *priv = netdev_priv(dev);
+
 	switch (sset) {
 	case ETH_SS_STATS:
-		return ARRAY_SIZE(fe_gdma_str);
+		if (priv->hw_stats)
+			return ARRAY_SIZE(fe_gdma_str) +
+			       ARRAY_SIZE(fe_rx_ring_str);
+		return ARRAY_SIZE(fe_rx_ring_str);
 	default:
 		return -EOPNOTSUPP;
 	}
 }
 
+static void fe_get_rx_ring_stats(struct fe_rx_ring *ring, u64 *data)
+{
+	struct fe_rx_ring_stats *stats = &ring->stats;
+	u64 *data_src, *data_dst;
+	unsigned int start;
+	int i;
+
+	do {
+		data_src = &stats->polls;
+		data_dst = data;
+		start = u64_stats_fetch_begin(&stats->syncp);
+
+		for (i = 0; i < ARRAY_SIZE(fe_rx_ring_str); i++)
+			*data_dst++ = *data_src++;
+
+	} while (u64_stats_fetch_retry(&stats->syncp, start));
+}
+
 static void fe_get_ethtool_stats(struct net_device *dev,
 				 struct ethtool_stats *stats, u64 *data)
 {
@@ -190,6 +226,9 @@ static void fe_get_ethtool_stats(struct net_device *dev,
 	unsigned int start;
 	int i;
 
+	if (!hwstats)
+		goto rx_ring;
+
 	if (netif_running(dev) && netif_device_present(dev)) {
 		if (spin_trylock(&hwstats->stats_lock)) {
 			fe_stats_update(priv);
@@ -206,9 +245,14 @@ static void fe_get_ethtool_stats(struct net_device *dev,
 			*data_dst++ = *data_src++;
 
 	} while (u64_stats_fetch_retry(&hwstats->syncp, start));
+
+	data += ARRAY_SIZE(fe_gdma_str);
+
+rx_ring:
+	fe_get_rx_ring_stats(&priv->rx_ring, data);
 }
 
-static struct ethtool_ops fe_ethtool_ops = {
+static const struct ethtool_ops fe_ethtool_ops = {
 	.get_link_ksettings	= fe_get_link_ksettings,
 	.set_link_ksettings	= fe_set_link_ksettings,
 	.get_drvinfo		= fe_get_drvinfo,
@@ -218,18 +262,12 @@ static struct ethtool_ops fe_ethtool_ops = {
 	.get_link		= fe_get_link,
 	.set_ringparam		= fe_set_ringparam,
 	.get_ringparam		= fe_get_ringparam,
+	.get_strings		= fe_get_strings,
+	.get_sset_count		= fe_get_sset_count,
+	.get_ethtool_stats	= fe_get_ethtool_stats,
 };
 
 void fe_set_ethtool_ops(struct net_device *netdev)
 {
-	struct fe_priv *priv = netdev_priv(netdev);
-	struct fe_soc_data *soc = priv->soc;
-
-	if (soc->reg_table[FE_REG_FE_COUNTER_BASE]) {
-		fe_ethtool_ops.get_strings = fe_get_strings;
-		fe_ethtool_ops.get_sset_count = fe_get_sset_count;
-		fe_ethtool_ops.get_ethtool_stats = fe_get_ethtool_stats;
-	}
-
 	netdev->ethtool_ops = &fe_ethtool_ops;
 }
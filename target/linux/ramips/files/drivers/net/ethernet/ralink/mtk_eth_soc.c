@@ -34,6 +34,7 @@
 #include <linux/gpio.h>
 #include <linux/gpio/consumer.h>
 #include <linux/version.h>
+#include <net/page_pool/helpers.h>
 
 #include <asm/mach-ralink/ralink_regs.h>
 
@@ -214,22 +215,80 @@ static inline void fe_set_txd(struct fe_tx_dma *txd, struct fe_tx_dma *dma_txd)
 	dma_txd->txd2 = txd->txd2;
 }
 
+static inline int fe_rx_pad(struct fe_priv *priv)
+{
+	if (priv->flags & FE_FLAG_RX_2B_OFFSET)
+		return 0;
+
+	return NET_IP_ALIGN;
+}
+
+static inline void fe_rx_desc_reset(struct fe_priv *priv,
+				    struct fe_rx_ring *ring,
+				    struct fe_rx_dma *rxd)
+{
+	if (priv->flags & FE_FLAG_RX_SG_DMA)
+		rxd->rxd2 = RX_DMA_PLEN0(ring->rx_buf_size);
+	else
+		rxd->rxd2 = RX_DMA_LSO;
+}
+
+/* rx buffers are page pool fragments. The pool keeps the pages mapped, so
+ * only the part the hardware may write to has to be handed back to the
+ * device before the buffer is placed on the ring again.
+ */
+static void *fe_rx_buf_alloc(struct fe_priv *priv, struct fe_rx_ring *ring,
+			     dma_addr_t *dma_addr, gfp_t gfp)
+{
+	unsigned int size = ring->frag_size;
+	void *data;
+
+	data = page_pool_alloc_va(ring->page_pool, &size, gfp);
+	if (unlikely(!data))
+		return NULL;
+
+	*dma_addr = page_pool_get_dma_addr(virt_to_head_page(data)) +
+		    offset_in_page(data) + NET_SKB_PAD + fe_rx_pad(priv);
+	dma_sync_single_for_device(priv->dev, *dma_addr, ring->rx_buf_size,
+				   DMA_FROM_DEVICE);
+
+	return data;
+}
+
+static int fe_rx_page_pool_create(struct fe_priv *priv)
+{
+	struct fe_rx_ring *ring = &priv->rx_ring;
+	struct page_pool_params pp_params = {
+		.order = 0,
+		.flags = PP_FLAG_DMA_MAP,
+		.pool_size = ring->rx_ring_size,
+		.nid = NUMA_NO_NODE,
+		.dev = priv->dev,
+		.dma_dir = DMA_FROM_DEVICE,
+		.napi = &priv->rx_napi,
+		.netdev = priv->netdev,
+	};
+	struct page_pool *pp;
+
+	pp = page_pool_create(&pp_params);
+	if (IS_ERR(pp))
+		return PTR_ERR(pp);
+
+	ring->page_pool = pp;
+
+	return 0;
+}
+
 static void fe_clean_rx(struct fe_priv *priv)
 {
 	struct fe_rx_ring *ring = &priv->rx_ring;
-	struct page *page;
 	int i;
 
 	if (ring->rx_data) {
 		for (i = 0; i < ring->rx_ring_size; i++)
-			if (ring->rx_data[i]) {
-				if (ring->rx_dma && ring->rx_dma[i].rxd1)
-					dma_unmap_single(priv->dev,
-							 ring->rx_dma[i].rxd1,
-							 ring->rx_buf_size,
-							 DMA_FROM_DEVICE);
-				skb_free_frag(ring->rx_data[i]);
-			}
+			if (ring->rx_data[i])
+				page_pool_free_va(ring->page_pool,
+						  ring->rx_data[i], false);
 
 		kfree(ring->rx_data);
 		ring->rx_data = NULL;
@@ -243,40 +302,25 @@ static void fe_clean_rx(struct fe_priv *priv)
 		ring->rx_dma = NULL;
 	}
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,13,0)
-	void *vaddr = (void *)(ring->frag_cache.encoded_page & PAGE_MASK);
-	if (!vaddr)
-		return;
-
-	page = virt_to_page(vaddr);
-#else
-	if (!ring->frag_cache.va)
-	    return;
-
-	page = virt_to_page(ring->frag_cache.va);
-#endif
-	__page_frag_cache_drain(page, ring->frag_cache.pagecnt_bias);
-	memset(&ring->frag_cache, 0, sizeof(ring->frag_cache));
+	if (ring->page_pool) {
+		page_pool_destroy(ring->page_pool);
+		ring->page_pool = NULL;
+	}
 }
 
 static int fe_alloc_rx(struct fe_priv *priv)
 {
 	struct fe_rx_ring *ring = &priv->rx_ring;
-	int i, pad;
+	int i;
+
+	if (fe_rx_page_pool_create(priv))
+		goto no_rx_mem;
 
 	ring->rx_data = kcalloc(ring->rx_ring_size, sizeof(*ring->rx_data),
 			GFP_KERNEL);
 	if (!ring->rx_data)
 		goto no_rx_mem;
 
-	for (i = 0; i < ring->rx_ring_size; i++) {
-		ring->rx_data[i] = page_frag_alloc(&ring->frag_cache,
-						   ring->frag_size,
-						   GFP_KERNEL);
-		if (!ring->rx_data[i])
-			goto no_rx_mem;
-	}
-
 	ring->rx_dma = dma_alloc_coherent(priv->dev,
 			ring->rx_ring_size * sizeof(*ring->rx_dma),
 			&ring->rx_phys,
@@ -284,23 +328,16 @@ static int fe_alloc_rx(struct fe_priv *priv)
 	if (!ring->rx_dma)
 		goto no_rx_mem;
 
-	if (priv->flags & FE_FLAG_RX_2B_OFFSET)
-		pad = 0;
-	else
-		pad = NET_IP_ALIGN;
 	for (i = 0; i < ring->rx_ring_size; i++) {
-		dma_addr_t dma_addr = dma_map_single(priv->dev,
-				ring->rx_data[i] + NET_SKB_PAD + pad,
-				ring->rx_buf_size,
-				DMA_FROM_DEVICE);
-		if (unlikely(dma_mapping_error(priv->dev, dma_addr)))
+		dma_addr_t dma_addr;
+
+		ring->rx_data[i] = fe_rx_buf_alloc(priv, ring, &dma_addr,
+						   GFP_KERNEL);
+		if (!ring->rx_data[i])
 			goto no_rx_mem;
-		ring->rx_dma[i].rxd1 = (unsigned int)dma_addr;
 
-		if (priv->flags & FE_FLAG_RX_SG_DMA)
-			ring->rx_dma[i].rxd2 = RX_DMA_PLEN0(ring->rx_buf_size);
-		else
-			ring->rx_dma[i].rxd2 = RX_DMA_LSO;
+		ring->rx_dma[i].rxd1 = (unsigned int)dma_addr;
+		fe_rx_desc_reset(priv, ring, &ring->rx_dma[i]);
 	}
 	ring->rx_calc_idx = ring->rx_ring_size - 1;
 	/* make sure that all changes to the dma ring are flushed before we
@@ -866,6 +903,24 @@ static int fe_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	return NETDEV_TX_OK;
 }
 
+static void fe_rx_stats_update(struct fe_rx_ring *ring, int done,
+			       int refill_fail, int build_skb_fail)
+{
+	struct fe_rx_ring_stats *stats = &ring->stats;
+	u64 *batch = &stats->batch_1;
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->polls++;
+	stats->refill_fail += refill_fail;
+	stats->build_skb_fail += build_skb_fail;
+	if (done) {
+		stats->descs += done;
+		stats->calc_idx_writes++;
+		batch[min_t(int, ilog2(done), FE_RX_BATCH_BUCKETS - 1)]++;
+	}
+	u64_stats_update_end(&stats->syncp);
+}
+
 static int fe_poll_rx(struct napi_struct *napi, int budget,
 		      struct fe_priv *priv, u32 rx_intr)
 {
@@ -875,20 +930,20 @@ static int fe_poll_rx(struct napi_struct *napi, int budget,
 	struct fe_rx_ring *ring = &priv->rx_ring;
 	int idx = ring->rx_calc_idx;
 	u32 checksum_bit;
-	struct sk_buff *skb;
+	struct sk_buff *skb, *next;
 	u8 *data, *new_data;
 	struct fe_rx_dma *rxd, trxd;
-	int done = 0, pad;
+	LIST_HEAD(rx_list);
+	int refill_fail = 0, build_skb_fail = 0;
+	int done = 0, hw_pad;
 
 	if (netdev->features & NETIF_F_RXCSUM)
 		checksum_bit = soc->checksum_bit;
 	else
 		checksum_bit = 0;
 
-	if (priv->flags & FE_FLAG_RX_2B_OFFSET)
-		pad = 0;
-	else
-		pad = NET_IP_ALIGN;
+	/* with FE_FLAG_RX_2B_OFFSET the hardware adds the alignment itself */
+	hw_pad = NET_IP_ALIGN - fe_rx_pad(priv);
 
 	while (done < budget) {
 		unsigned int pktlen;
@@ -902,33 +957,30 @@ static int fe_poll_rx(struct napi_struct *napi, int budget,
 		if (!(trxd.rxd2 & RX_DMA_DONE))
 			break;
 
-		/* alloc new buffer */
-		new_data = page_frag_alloc(&ring->frag_cache, ring->frag_size,
-					   GFP_ATOMIC);
+		/* alloc new buffer, on failure the old one stays on the ring
+		 * and the packet is dropped
+		 */
+		new_data = fe_rx_buf_alloc(priv, ring, &dma_addr, GFP_ATOMIC);
 		if (unlikely(!new_data)) {
+			refill_fail++;
 			stats->rx_dropped++;
 			goto release_desc;
 		}
-		dma_addr = dma_map_single(priv->dev,
-					  new_data + NET_SKB_PAD + pad,
-					  ring->rx_buf_size,
-					  DMA_FROM_DEVICE);
-		if (unlikely(dma_mapping_error(priv->dev, dma_addr))) {
-			skb_free_frag(new_data);
-			goto release_desc;
-		}
 
 		/* receive data */
-		skb = build_skb(data, ring->frag_size);
+		skb = napi_build_skb(data, ring->frag_size);
 		if (unlikely(!skb)) {
-			skb_free_frag(new_data);
+			page_pool_free_va(ring->page_pool, new_data, true);
+			build_skb_fail++;
+			stats->rx_dropped++;
 			goto release_desc;
 		}
+		skb_mark_for_recycle(skb);
 		skb_reserve(skb, NET_SKB_PAD + NET_IP_ALIGN);
 
-		dma_unmap_single(priv->dev, trxd.rxd1,
-				 ring->rx_buf_size, DMA_FROM_DEVICE);
 		pktlen = RX_DMA_GET_PLEN0(trxd.rxd2);
+		dma_sync_single_for_cpu(priv->dev, trxd.rxd1, pktlen + hw_pad,
+					DMA_FROM_DEVICE);
 		skb->dev = netdev;
 		skb_put(skb, pktlen);
 		if (trxd.rxd4 & checksum_bit)
@@ -945,24 +997,30 @@ static int fe_poll_rx(struct napi_struct *napi, int budget,
 		stats->rx_packets++;
 		stats->rx_bytes += pktlen;
 
-		napi_gro_receive(napi, skb);
+		list_add_tail(&skb->list, &rx_list);
 
 		ring->rx_data[idx] = new_data;
 		rxd->rxd1 = (unsigned int)dma_addr;
 
 release_desc:
-		if (priv->flags & FE_FLAG_RX_SG_DMA)
-			rxd->rxd2 = RX_DMA_PLEN0(ring->rx_buf_size);
-		else
-			rxd->rxd2 = RX_DMA_LSO;
-
+		fe_rx_desc_reset(priv, ring, rxd);
 		ring->rx_calc_idx = idx;
-		/* make sure that all changes to the dma ring are flushed before
-		 * we continue
+		done++;
+	}
+
+	if (done) {
+		/* hand all refilled descriptors back to the hardware at once,
+		 * make sure that all changes to the dma ring are flushed first
 		 */
 		wmb();
 		fe_reg_w32(ring->rx_calc_idx, FE_REG_RX_CALC_IDX0);
-		done++;
+	}
+	fe_rx_stats_update(ring, done, refill_fail, build_skb_fail);
+
+	/* the ring is already refilled, now pass the batch up the stack */
+	list_for_each_entry_safe(skb, next, &rx_list, list) {
+		skb_list_del_init(skb);
+		napi_gro_receive(napi, skb);
 	}
 
 	if (done < budget)
@@ -1618,6 +1676,7 @@ static int fe_probe(struct platform_device *pdev)
 	priv->rx_ring.rx_buf_size = fe_max_buf_size(priv->rx_ring.frag_size);
 	priv->tx_ring.tx_ring_size = NUM_DMA_DESC;
 	priv->rx_ring.rx_ring_size = NUM_DMA_DESC;
+	u64_stats_init(&priv->rx_ring.stats.syncp);
 	INIT_WORK(&priv->pending_work, fe_pending_work);
 
 	napi_weight = 16;
@@ -21,6 +21,8 @@
 #include <linux/dma-mapping.h>
 #include <linux/phy.h>
 #include <linux/ethtool.h>
+#include <linux/u64_stats_sync.h>
+#include <net/page_pool/types.h>
 
 enum fe_reg {
 	FE_REG_PDMA_GLO_CFG = 0,
@@ -450,8 +452,32 @@ struct fe_tx_ring {
 	u16 tx_thresh;
 };
 
+/* software rx ring counters, batch_* is a histogram of packets per poll */
+#define FE_RX_RING_STAT_DECLARE		\
+	_FE(polls)			\
+	_FE(descs)			\
+	_FE(refill_fail)		\
+	_FE(build_skb_fail)		\
+	_FE(calc_idx_writes)		\
+	_FE(batch_1)			\
+	_FE(batch_2_3)			\
+	_FE(batch_4_7)			\
+	_FE(batch_8_15)			\
+	_FE(batch_16_31)		\
+	_FE(batch_32_63)		\
+	_FE(batch_64_plus)
+
+#define FE_RX_BATCH_BUCKETS		7
+
+struct fe_rx_ring_stats {
+	struct u64_stats_sync syncp;
+#define _FE(x) u64 x;
+	FE_RX_RING_STAT_DECLARE
+#undef _FE
+};
+
 struct fe_rx_ring {
-	struct page_frag_cache frag_cache;
+	struct page_pool *page_pool;
 	struct fe_rx_dma *rx_dma;
 	u8 **rx_data;
 	dma_addr_t rx_phys;
@@ -459,6 +485,7 @@ struct fe_rx_ring {
 	u16 frag_size;
 	u16 rx_buf_size;
 	u16 rx_calc_idx;
+	struct fe_rx_ring_stats stats;
 };
 
 struct fe_priv {
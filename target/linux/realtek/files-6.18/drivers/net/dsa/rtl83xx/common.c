@@ -108,8 +108,14 @@ static int rtl_table_exec(struct table_reg *r, bool is_write, int idx)
 
 	sw_w32(cmd, r->addr);
 
-	ret = readx_poll_timeout(sw_r32, r->addr, val,
-				 !(val & BIT(r->c_bit + 1)), 20, 10000);
+	/* Most accesses complete within a microsecond, so spin briefly before
+	 * falling back to sleeping between polls
+	 */
+	ret = readx_poll_timeout_atomic(sw_r32, r->addr, val,
+					!(val & BIT(r->c_bit + 1)), 0, 10);
+	if (ret)
+		ret = readx_poll_timeout(sw_r32, r->addr, val,
+					 !(val & BIT(r->c_bit + 1)), 20, 10000);
 	if (ret)
 		pr_err("%s: timeout\n", __func__);
 
@@ -636,25 +642,156 @@ int rtldsa_93xx_lag_set_port_members(struct rtl838x_switch_priv *priv, int group
 	return 0;
 }
 
-// Currently Unused
-// /* Allocate a 64 bit octet counter located in the LOG HW table */
-// static int rtl83xx_octet_cntr_alloc(struct rtl838x_switch_priv *priv)
-// {
-// 	int idx;
+/* Read n consecutive entries of the L2 hash table starting at physical index idx,
+ * holding the table lock across the whole batch where the SoC supports this
+ */
+void rtldsa_l2_read_batch(struct rtl838x_switch_priv *priv, int idx, int n,
+			  struct rtl838x_l2_entry *e)
+{
+	if (priv->r->read_l2_entries) {
+		priv->r->read_l2_entries(idx, n, e);
+		return;
+	}
+
+	for (int i = 0; i < n; i++)
+		priv->r->read_l2_entry_using_hash((idx + i) >> 2, (idx + i) & 0x3, &e[i]);
+}
+
+/* The VLAN table is only ever changed by the driver, so a shadow copy of it is
+ * kept in RAM. Entries are filled on first read and updated on write.
+ */
+void rtldsa_vlan_tables_read(struct rtl838x_switch_priv *priv, u32 vlan,
+			     struct rtl838x_vlan_info *info)
+{
+	mutex_lock(&priv->vlan_cache_lock);
+
+	if (!test_bit(vlan, priv->vlan_cache_valid)) {
+		priv->r->vlan_tables_read(vlan, &priv->vlan_cache[vlan]);
+		set_bit(vlan, priv->vlan_cache_valid);
+	}
+	*info = priv->vlan_cache[vlan];
+
+	mutex_unlock(&priv->vlan_cache_lock);
+}
+
+void rtldsa_vlan_set_tagged(struct rtl838x_switch_priv *priv, u32 vlan,
+			    struct rtl838x_vlan_info *info)
+{
+	mutex_lock(&priv->vlan_cache_lock);
+
+	priv->r->vlan_set_tagged(vlan, info);
+
+	/* The untagged ports live in a separate table not written here */
+	if (test_bit(vlan, priv->vlan_cache_valid)) {
+		u64 untagged_ports = priv->vlan_cache[vlan].untagged_ports;
+
+		priv->vlan_cache[vlan] = *info;
+		priv->vlan_cache[vlan].untagged_ports = untagged_ports;
+	}
+
+	mutex_unlock(&priv->vlan_cache_lock);
+}
+
+void rtldsa_vlan_set_untagged(struct rtl838x_switch_priv *priv, u32 vlan, u64 portmask)
+{
+	mutex_lock(&priv->vlan_cache_lock);
+
+	priv->r->vlan_set_untagged(vlan, portmask);
+
+	/* The SoC ignores bits of non-existing ports */
+	if (test_bit(vlan, priv->vlan_cache_valid))
+		priv->vlan_cache[vlan].untagged_ports = portmask & GENMASK_ULL(priv->r->cpu_port, 0);
+
+	mutex_unlock(&priv->vlan_cache_lock);
+}
+
+static void rtldsa_vlan_cache_free(void *data)
+{
+	kvfree(data);
+}
+
+static int rtldsa_vlan_cache_init(struct rtl838x_switch_priv *priv)
+{
+	int err;
+
+	err = devm_mutex_init(priv->dev, &priv->vlan_cache_lock);
+	if (err)
+		return err;
+
+	priv->vlan_cache = kvcalloc(MAX_VLANS, sizeof(*priv->vlan_cache), GFP_KERNEL);
+	if (!priv->vlan_cache)
+		return -ENOMEM;
+
+	return devm_add_action_or_reset(priv->dev, rtldsa_vlan_cache_free, priv->vlan_cache);
+}
+
+/* Reset a 32-bit packet counter both in HW and in its software copy */
+static void rtl83xx_log_cntr_reset(struct rtl838x_switch_priv *priv, int idx)
+{
+	if (priv->r->packet_cntr_clear)
+		priv->r->packet_cntr_clear(idx);
+
+	if (priv->log_cntrs) {
+		spin_lock(&priv->log_cntrs_lock);
+		priv->log_cntrs[idx] = 0;
+		spin_unlock(&priv->log_cntrs_lock);
+	}
+}
 
-// 	mutex_lock(&priv->reg_mutex);
+#define RTL83XX_LOG_CNTRS_BATCH		32
+#define RTL83XX_LOG_CNTRS_POLL_INTERVAL	HZ
 
-// 	idx = find_first_zero_bit(priv->octet_cntr_use_bm, MAX_COUNTERS);
-// 	if (idx >= priv->r->n_counters) {
-// 		mutex_unlock(&priv->reg_mutex);
-// 		return -1;
-// 	}
+/* Account a newly allocated counter, starting the poller for the first one.
+ * Called with reg_mutex held.
+ */
+static void rtl83xx_log_cntrs_get(struct rtl838x_switch_priv *priv)
+{
+	if (priv->log_cntrs && !priv->log_cntrs_users++)
+		queue_delayed_work(priv->wq, &priv->log_cntrs_work,
+				   RTL83XX_LOG_CNTRS_POLL_INTERVAL);
+}
 
-// 	set_bit(idx, priv->octet_cntr_use_bm);
-// 	mutex_unlock(&priv->reg_mutex);
+/* Called with reg_mutex held, the poller stops by itself once no counter is left */
+static void rtl83xx_log_cntrs_put(struct rtl838x_switch_priv *priv)
+{
+	if (priv->log_cntrs)
+		priv->log_cntrs_users--;
+}
 
-// 	return idx;
-// }
+/* Allocate a 64 bit octet counter located in the LOG HW table */
+int rtl83xx_octet_cntr_alloc(struct rtl838x_switch_priv *priv)
+{
+	int idx;
+
+	mutex_lock(&priv->reg_mutex);
+
+	idx = find_first_zero_bit(priv->octet_cntr_use_bm, MAX_COUNTERS);
+	if (idx >= priv->r->n_counters) {
+		mutex_unlock(&priv->reg_mutex);
+		return -1;
+	}
+
+	set_bit(idx, priv->octet_cntr_use_bm);
+	set_bit(idx, priv->log_octet_bm);
+
+	/* The octet counter covers both packet counters of the LOG entry */
+	rtl83xx_log_cntr_reset(priv, idx * 2);
+	rtl83xx_log_cntr_reset(priv, idx * 2 + 1);
+	rtl83xx_log_cntrs_get(priv);
+
+	mutex_unlock(&priv->reg_mutex);
+
+	return idx;
+}
+
+void rtl83xx_octet_cntr_free(struct rtl838x_switch_priv *priv, int idx)
+{
+	mutex_lock(&priv->reg_mutex);
+	clear_bit(idx, priv->log_octet_bm);
+	clear_bit(idx, priv->octet_cntr_use_bm);
+	rtl83xx_log_cntrs_put(priv);
+	mutex_unlock(&priv->reg_mutex);
+}
 
 /* Allocate a 32-bit packet counter
  * 2 32-bit packet counters share the location of a 64-bit octet counter
@@ -685,11 +822,123 @@ int rtl83xx_packet_cntr_alloc(struct rtl838x_switch_priv *priv)
 		clear_bit(idx, priv->packet_cntr_use_bm);
 	}
 
+	rtl83xx_log_cntr_reset(priv, idx);
+	rtl83xx_log_cntrs_get(priv);
+
 	mutex_unlock(&priv->reg_mutex);
 
 	return idx;
 }
 
+void rtl83xx_packet_cntr_free(struct rtl838x_switch_priv *priv, int idx)
+{
+	mutex_lock(&priv->reg_mutex);
+	set_bit(idx, priv->packet_cntr_use_bm);
+	rtl83xx_log_cntrs_put(priv);
+	mutex_unlock(&priv->reg_mutex);
+}
+
+/* Counter values are served from the software copy kept up to date by
+ * rtl83xx_poll_log_cntrs(), so reading them never touches the hardware
+ */
+u64 rtl83xx_packet_cntr_get(struct rtl838x_switch_priv *priv, int idx)
+{
+	u64 v;
+
+	if (!priv->log_cntrs)
+		return 0;
+
+	spin_lock(&priv->log_cntrs_lock);
+	v = priv->log_cntrs[idx];
+	spin_unlock(&priv->log_cntrs_lock);
+
+	return v;
+}
+
+u64 rtl83xx_octet_cntr_get(struct rtl838x_switch_priv *priv, int idx)
+{
+	return rtl83xx_packet_cntr_get(priv, idx * 2);
+}
+
+/* Extend a 32-bit HW packet counter into its 64-bit software copy */
+static void rtl83xx_log_cntr_update(u64 *cntr, u32 hw)
+{
+	*cntr += (u32)(hw - (u32)*cntr);
+}
+
+/* Periodically read all LOG table entries in use and fold them into the 64-bit
+ * software copies. The hardware reads one entry per table access, batching only
+ * saves taking the table and reg_mutex for each of them. At one second intervals
+ * the 32-bit packet counters cannot wrap more than once between two polls even
+ * at line rate.
+ */
+static void rtl83xx_poll_log_cntrs(struct work_struct *work)
+{
+	struct rtl838x_switch_priv *priv = container_of(to_delayed_work(work),
+							struct rtl838x_switch_priv,
+							log_cntrs_work);
+	u32 data[RTL83XX_LOG_CNTRS_BATCH * 2];
+	int entries = priv->r->n_counters;
+	int idx = 0, n;
+
+	for (;;) {
+		mutex_lock(&priv->reg_mutex);
+
+		idx = find_next_bit(priv->octet_cntr_use_bm, entries, idx);
+		if (idx >= entries) {
+			mutex_unlock(&priv->reg_mutex);
+			break;
+		}
+
+		n = min(entries - idx, RTL83XX_LOG_CNTRS_BATCH);
+		priv->r->log_table_read(idx, n, data);
+
+		spin_lock(&priv->log_cntrs_lock);
+		for (int i = 0; i < n; i++) {
+			u64 *cntr = &priv->log_cntrs[(idx + i) * 2];
+
+			if (!test_bit(idx + i, priv->octet_cntr_use_bm))
+				continue;
+
+			if (test_bit(idx + i, priv->log_octet_bm)) {
+				cntr[0] = ((u64)data[i * 2] << 32) | data[i * 2 + 1];
+			} else {
+				/* Even packet counters are in the 2nd register, odd ones in the 1st */
+				rtl83xx_log_cntr_update(&cntr[0], data[i * 2 + 1]);
+				rtl83xx_log_cntr_update(&cntr[1], data[i * 2]);
+			}
+		}
+		spin_unlock(&priv->log_cntrs_lock);
+
+		mutex_unlock(&priv->reg_mutex);
+
+		idx += n;
+		cond_resched();
+	}
+
+	mutex_lock(&priv->reg_mutex);
+	if (priv->log_cntrs_users)
+		queue_delayed_work(priv->wq, &priv->log_cntrs_work,
+				   RTL83XX_LOG_CNTRS_POLL_INTERVAL);
+	mutex_unlock(&priv->reg_mutex);
+}
+
+int rtl83xx_log_cntrs_init(struct rtl838x_switch_priv *priv)
+{
+	if (!priv->r->log_table_read)
+		return 0;
+
+	priv->log_cntrs = devm_kcalloc(priv->dev, priv->r->n_counters * 2,
+				       sizeof(*priv->log_cntrs), GFP_KERNEL);
+	if (!priv->log_cntrs)
+		return -ENOMEM;
+
+	spin_lock_init(&priv->log_cntrs_lock);
+	INIT_DELAYED_WORK(&priv->log_cntrs_work, rtl83xx_poll_log_cntrs);
+
+	return 0;
+}
+
 /* Add an L2 nexthop entry for the L3 routing system / PIE forwarding in the SoC
  * Use VID and MAC in rtl838x_l2_entry to identify either a free slot in the L2 hash table
  * or mark an existing entry as a nexthop by setting it's nexthop bit
@@ -917,6 +1166,10 @@ static int rtl83xx_sw_probe(struct platform_device *pdev)
 	if (err)
 		return err;
 
+	err = rtldsa_vlan_cache_init(priv);
+	if (err)
+		return err;
+
 	priv->family_id = soc_info.family;
 	sw_w32(0, priv->r->spanning_tree_ctrl);
 	priv->irq_mask = GENMASK_ULL(priv->r->cpu_port - 1, 0);
@@ -1055,6 +1308,8 @@ static void rtl83xx_sw_remove(struct platform_device *pdev)
 	 */
 	otto_l3_remove(priv);
 	cancel_delayed_work_sync(&priv->counters_work);
+	if (priv->log_cntrs)
+		cancel_delayed_work_sync(&priv->log_cntrs_work);
 
 	dsa_switch_shutdown(priv->ds);
 
@@ -4,6 +4,7 @@
 #include <linux/kernel.h>
 #include <asm/mach-rtl-otto/mach-rtl-otto.h>
 
+#include "l3.h"
 #include "rtl-otto.h"
 
 #define RTL838X_DRIVER_NAME "rtl838x"
@@ -319,26 +320,32 @@ static void l2_table_print_entry(struct seq_file *m, struct rtl838x_switch_priv
 static int l2_table_show(struct seq_file *m, void *v)
 {
 	struct rtl838x_switch_priv *priv = m->private;
-	struct rtl838x_l2_entry e;
-	int bucket, index;
+	struct rtl838x_l2_entry e, *batch;
+
+	batch = kmalloc_array(L2_READ_BATCH, sizeof(*batch), GFP_KERNEL);
+	if (!batch)
+		return -ENOMEM;
 
 	mutex_lock(&priv->reg_mutex);
 
-	for (int i = 0; i < priv->r->fib_entries; i++) {
-		bucket = i >> 2;
-		index = i & 0x3;
-		priv->r->read_l2_entry_using_hash(bucket, index, &e);
+	for (int i = 0; i < priv->r->fib_entries; i += L2_READ_BATCH) {
+		int n = min_t(u32, L2_READ_BATCH, priv->r->fib_entries - i);
 
-		if (!e.valid)
-			continue;
+		rtldsa_l2_read_batch(priv, i, n, batch);
 
-		seq_printf(m, "Hash table bucket %d index %d ", bucket, index);
-		l2_table_print_entry(m, priv, &e);
+		for (int j = 0; j < n; j++) {
+			if (!batch[j].valid)
+				continue;
 
-		if (!((i + 1) % 64))
-			cond_resched();
+			seq_printf(m, "Hash table bucket %d index %d ", (i + j) >> 2, (i + j) & 0x3);
+			l2_table_print_entry(m, priv, &batch[j]);
+		}
+
+		cond_resched();
 	}
 
+	kfree(batch);
+
 	for (int i = 0; i < 64; i++) {
 		priv->r->read_cam(i, &e);
 
@@ -559,7 +566,7 @@ static int rtldsa_vlan_table_show(struct seq_file *m, void *v)
 	mutex_lock(&priv->reg_mutex);
 
 	for (int i = 0; i < MAX_VLANS; i++) {
-		priv->r->vlan_tables_read(i, &info);
+		rtldsa_vlan_tables_read(priv, i, &info);
 
 		if (!info.member_ports)
 			continue;
@@ -590,6 +597,71 @@ static const struct file_operations rtldsa_vlan_table_fops = {
 	.release = single_release,
 };
 
+static void l3_route_print_entry(struct seq_file *m, struct otto_l3_route *rt)
+{
+	if (rt->attr.type == OTTO_L3_ROUTE_IP6_UC)
+		seq_printf(m, " %pI6", &rt->dst_ip6);
+	else
+		seq_printf(m, " %pI4", &rt->dst_ip);
+
+	if (rt->prefix_len >= 0)
+		seq_printf(m, "/%d", rt->prefix_len);
+
+	seq_printf(m, " nh %u action %u%s%s\n", rt->nh.id, rt->attr.action,
+		   rt->attr.hit ? " hit" : "", rt->attr.ttl_dec ? " ttl_dec" : "");
+}
+
+static int l3_routes_show(struct seq_file *m, void *v)
+{
+	struct rtl838x_switch_priv *priv = m->private;
+	struct otto_l3_route rt;
+
+	mutex_lock(&priv->reg_mutex);
+
+	for (int i = 0; i < MAX_ROUTES; i++) {
+		memset(&rt, 0, sizeof(rt));
+		priv->r->route_read(i, &rt);
+
+		if (!rt.attr.valid)
+			continue;
+
+		seq_printf(m, "Prefix route %d", i);
+		l3_route_print_entry(m, &rt);
+	}
+
+	for (int i = 0; i < MAX_HOST_ROUTE_SLOTS; i++) {
+		memset(&rt, 0, sizeof(rt));
+		rt.prefix_len = -1;
+		priv->r->host_route_read(i, &rt);
+
+		if (!rt.attr.valid)
+			continue;
+
+		seq_printf(m, "Host route %d", i);
+		l3_route_print_entry(m, &rt);
+
+		if (!((i + 1) % 64))
+			cond_resched();
+	}
+
+	mutex_unlock(&priv->reg_mutex);
+
+	return 0;
+}
+
+static int l3_routes_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, l3_routes_show, inode->i_private);
+}
+
+static const struct file_operations l3_routes_fops = {
+	.owner = THIS_MODULE,
+	.open = l3_routes_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static ssize_t age_out_read(struct file *filp, char __user *buffer, size_t count,
 			    loff_t *ppos)
 {
@@ -974,4 +1046,7 @@ void rtl930x_dbgfs_init(struct rtl838x_switch_priv *priv)
 
 	debugfs_create_file("vlan_table", 0400, dbg_dir, priv,
 			    &rtldsa_vlan_table_fops);
+
+	if (priv->r->route_read && priv->r->host_route_read)
+		debugfs_create_file("l3_routes", 0400, dbg_dir, priv, &l3_routes_fops);
 }
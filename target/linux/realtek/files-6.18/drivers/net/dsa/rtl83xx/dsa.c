@@ -122,7 +122,7 @@ static void rtldsa_vlan_setup(struct rtl838x_switch_priv *priv)
 
 	/* Initialize normal VLANs 1-4095 */
 	for (int i = 1; i < MAX_VLANS; i++)
-		priv->r->vlan_set_tagged(i, &info);
+		rtldsa_vlan_set_tagged(priv, i, &info);
 
 	/*
 	 * Initialize the special VLAN 0 and reset PVIDs. The CPU port PVID
@@ -135,7 +135,7 @@ static void rtldsa_vlan_setup(struct rtl838x_switch_priv *priv)
 		rtldsa_vlan_set_pvid(priv, i, 0);
 		info.member_ports |= BIT_ULL(i);
 	}
-	priv->r->vlan_set_tagged(0, &info);
+	rtldsa_vlan_set_tagged(priv, 0, &info);
 
 	/* Set forwarding action based on inner VLAN tag */
 	for (int i = 0; i < priv->r->cpu_port; i++)
@@ -227,7 +227,7 @@ static int rtldsa_83xx_setup(struct dsa_switch *ds)
 	msleep(1000);
 	priv->r->pie_init(priv);
 
-	return 0;
+	return rtl83xx_log_cntrs_init(priv);
 }
 
 static int rtldsa_93xx_setup(struct dsa_switch *ds)
@@ -283,7 +283,7 @@ static int rtldsa_93xx_setup(struct dsa_switch *ds)
 
 	priv->r->led_init(priv);
 
-	return 0;
+	return rtl83xx_log_cntrs_init(priv);
 }
 
 static int rtldsa_phylink_fill_available_pcs(struct phylink_config *config,
@@ -1591,20 +1591,20 @@ static int rtldsa_vlan_prepare(struct dsa_switch *ds, int port,
 	struct rtl838x_vlan_info info;
 	struct rtl838x_switch_priv *priv = ds->priv;
 
-	priv->r->vlan_tables_read(0, &info);
+	rtldsa_vlan_tables_read(priv, 0, &info);
 
 	pr_debug("VLAN 0: Member ports %llx, untag %llx, profile %d, MC# %d, UC# %d, FID %x\n",
 		 info.member_ports, info.untagged_ports, info.profile_id,
 		 info.hash_mc_fid, info.hash_uc_fid, info.fid);
 
-	priv->r->vlan_tables_read(1, &info);
+	rtldsa_vlan_tables_read(priv, 1, &info);
 	pr_debug("VLAN 1: Member ports %llx, untag %llx, profile %d, MC# %d, UC# %d, FID %x\n",
 		 info.member_ports, info.untagged_ports, info.profile_id,
 		 info.hash_mc_fid, info.hash_uc_fid, info.fid);
-	priv->r->vlan_set_untagged(1, info.untagged_ports);
+	rtldsa_vlan_set_untagged(priv, 1, info.untagged_ports);
 	pr_debug("SET: Untagged ports, VLAN %d: %llx\n", 1, info.untagged_ports);
 
-	priv->r->vlan_set_tagged(1, &info);
+	rtldsa_vlan_set_tagged(priv, 1, &info);
 	pr_debug("SET: Member ports, VLAN %d: %llx\n", 1, info.member_ports);
 
 	return 0;
@@ -1652,7 +1652,7 @@ static int rtldsa_vlan_add(struct dsa_switch *ds, int port,
 	}
 
 	/* Get port memberships of this vlan */
-	priv->r->vlan_tables_read(vlan->vid, &info);
+	rtldsa_vlan_tables_read(priv, vlan->vid, &info);
 
 	/* new VLAN? */
 	if (!info.member_ports) {
@@ -1672,10 +1672,10 @@ static int rtldsa_vlan_add(struct dsa_switch *ds, int port,
 	else
 		info.untagged_ports &= ~BIT_ULL(port);
 
-	priv->r->vlan_set_untagged(vlan->vid, info.untagged_ports);
+	rtldsa_vlan_set_untagged(priv, vlan->vid, info.untagged_ports);
 	pr_debug("Untagged ports, VLAN %d: %llx\n", vlan->vid, info.untagged_ports);
 
-	priv->r->vlan_set_tagged(vlan->vid, &info);
+	rtldsa_vlan_set_tagged(priv, vlan->vid, &info);
 	pr_debug("Member ports, VLAN %d: %llx\n", vlan->vid, info.member_ports);
 
 	mutex_unlock(&priv->reg_mutex);
@@ -1710,7 +1710,7 @@ static int rtldsa_vlan_del(struct dsa_switch *ds, int port,
 		rtldsa_vlan_set_pvid(priv, port, 0);
 
 	/* Get port memberships of this vlan */
-	priv->r->vlan_tables_read(vlan->vid, &info);
+	rtldsa_vlan_tables_read(priv, vlan->vid, &info);
 
 	/* remove port from both tables */
 	info.untagged_ports &= (~BIT_ULL(port));
@@ -1725,10 +1725,10 @@ static int rtldsa_vlan_del(struct dsa_switch *ds, int port,
 		rtldsa_mst_put_slot(priv, mst);
 	}
 
-	priv->r->vlan_set_untagged(vlan->vid, info.untagged_ports);
+	rtldsa_vlan_set_untagged(priv, vlan->vid, info.untagged_ports);
 	pr_debug("Untagged ports, VLAN %d: %llx\n", vlan->vid, info.untagged_ports);
 
-	priv->r->vlan_set_tagged(vlan->vid, &info);
+	rtldsa_vlan_set_tagged(priv, vlan->vid, &info);
 	pr_debug("Member ports, VLAN %d: %llx\n", vlan->vid, info.member_ports);
 
 	mutex_unlock(&priv->reg_mutex);
@@ -1769,7 +1769,7 @@ static int rtldsa_vlan_msti_set(struct dsa_switch *ds, struct dsa_bridge bridge,
 	u16 mst_slot_old;
 	int mst_slot;
 
-	priv->r->vlan_tables_read(msti->vid, &info);
+	rtldsa_vlan_tables_read(priv, msti->vid, &info);
 	mst_slot_old = info.fid;
 
 	/* find HW slot for MSTI */
@@ -1781,7 +1781,7 @@ static int rtldsa_vlan_msti_set(struct dsa_switch *ds, struct dsa_bridge bridge,
 		return mst_slot;
 
 	info.fid = mst_slot;
-	priv->r->vlan_set_tagged(msti->vid, &info);
+	rtldsa_vlan_set_tagged(priv, msti->vid, &info);
 
 	return 0;
 }
@@ -2002,28 +2002,37 @@ out:
 static int rtldsa_port_fdb_dump(struct dsa_switch *ds, int port,
 				dsa_fdb_dump_cb_t *cb, void *data)
 {
-	struct rtl838x_l2_entry e;
+	struct rtl838x_l2_entry e, *batch;
 	struct rtl838x_switch_priv *priv = ds->priv;
 
+	batch = kmalloc_array(L2_READ_BATCH, sizeof(*batch), GFP_KERNEL);
+	if (!batch)
+		return -ENOMEM;
+
 	mutex_lock(&priv->reg_mutex);
 
-	for (int i = 0; i < priv->r->fib_entries; i++) {
-		priv->r->read_l2_entry_using_hash(i >> 2, i & 0x3, &e);
+	for (int i = 0; i < priv->r->fib_entries; i += L2_READ_BATCH) {
+		int n = min_t(u32, L2_READ_BATCH, priv->r->fib_entries - i);
 
-		if (!e.valid)
-			continue;
+		rtldsa_l2_read_batch(priv, i, n, batch);
 
-		// Ignore trunk fdb entries
-		if (e.is_trunk)
-			continue;
+		for (int j = 0; j < n; j++) {
+			if (!batch[j].valid)
+				continue;
 
-		if (e.port == port || e.port == RTL930X_PORT_IGNORE)
-			cb(e.mac, e.vid, e.is_static, data);
+			// Ignore trunk fdb entries
+			if (batch[j].is_trunk)
+				continue;
 
-		if (!((i + 1) % 64))
-			cond_resched();
+			if (batch[j].port == port || batch[j].port == RTL930X_PORT_IGNORE)
+				cb(batch[j].mac, batch[j].vid, batch[j].is_static, data);
+		}
+
+		cond_resched();
 	}
 
+	kfree(batch);
+
 	for (int i = 0; i < 64; i++) {
 		priv->r->read_cam(i, &e);
 
@@ -7,6 +7,7 @@
 #include <net/arp.h>
 #include <net/fib_notifier.h>
 #include <net/ip6_fib.h>
+#include <net/ndisc.h>
 #include <net/netevent.h>
 #include <net/nexthop.h>
 #include <uapi/linux/rtnetlink.h>
@@ -19,6 +20,8 @@ struct otto_l3_net_event_work {
 	struct rtl838x_switch_priv *priv;
 	u64 mac;
 	u32 gw_addr;
+	struct in6_addr gw_addr6;
+	bool is_ipv6;
 };
 
 struct otto_l3_fib_event_work {
@@ -154,6 +157,80 @@ static int otto_l3_alloc_egress_intf(struct rtl838x_switch_priv *priv, u64 mac,
 	return free_mac;
 }
 
+/* Programs a route towards a resolved gateway MAC into the ROUTING table and PIE */
+static void otto_l3_route_hw_update(struct rtl838x_switch_priv *priv, struct otto_l3_route *r,
+				    u64 mac)
+{
+	/* Reads the ROUTING table entry associated with the route */
+	if (!r->is_host_route)
+		priv->r->route_read(r->id, r);
+	if (r->is_ipv6)
+		pr_debug("Route with id %d to %pI6 / %d\n", r->id, &r->dst_ip6, r->prefix_len);
+	else
+		pr_debug("Route with id %d to %pI4 / %d\n", r->id, &r->dst_ip, r->prefix_len);
+
+	r->nh.mac = r->nh.gw = mac;
+	r->nh.port = priv->r->port_ignore;
+	r->nh.id = r->id;
+
+	/* Do we need to explicitly add a DMAC entry with the route's nh index? */
+	if (priv->r->set_l3_egress_mac)
+		priv->r->set_l3_egress_mac(r->id, mac);
+
+	/* Update ROUTING table: map gateway-mac and switch-mac id to route id */
+	rtl83xx_l2_nexthop_add(priv, &r->nh);
+
+	r->attr.valid = true;
+	r->attr.action = ROUTE_ACT_FORWARD;
+	r->attr.type = r->is_ipv6 ? OTTO_L3_ROUTE_IP6_UC : OTTO_L3_ROUTE_IP4_UC;
+	r->attr.hit = false; /* Reset route-used indicator */
+
+	/* Add PIE entry with dst_ip and prefix_len */
+	if (r->is_ipv6) {
+		struct in6_addr all_ones;
+
+		memset(&all_ones, 0xff, sizeof(all_ones));
+		r->pr.is_ipv6 = true;
+		ipv6_addr_prefix(&r->pr.dip6, &r->dst_ip6, r->prefix_len);
+		ipv6_addr_prefix(&r->pr.dip6_m, &all_ones, r->prefix_len);
+	} else {
+		r->pr.dip = r->dst_ip;
+		r->pr.dip_m = inet_make_mask(r->prefix_len);
+	}
+
+	if (r->is_host_route) {
+		int slot = priv->r->find_l3_slot(r, false);
+
+		pr_info("%s: Got slot for route: %d\n", __func__, slot);
+		if (slot >= 0)
+			priv->r->host_route_write(slot, r);
+	} else {
+		priv->r->route_write(r->id, r);
+		r->pr.fwd_sel = true;
+		r->pr.fwd_data = r->nh.l2_id;
+		r->pr.fwd_act = PIE_ACT_ROUTE_UC;
+	}
+
+	if (priv->r->set_l3_nexthop)
+		priv->r->set_l3_nexthop(r->nh.id, r->nh.l2_id, r->nh.if_id);
+
+	if (r->pr.id < 0) {
+		r->pr.packet_cntr = rtl83xx_packet_cntr_alloc(priv);
+		if (r->pr.packet_cntr >= 0) {
+			pr_info("Using packet counter %d\n", r->pr.packet_cntr);
+			r->pr.log_sel = true;
+			r->pr.log_data = r->pr.packet_cntr;
+		}
+		priv->r->pie_rule_add(priv, &r->pr);
+	} else {
+		u64 pkts = rtl83xx_packet_cntr_get(priv, r->pr.packet_cntr);
+
+		pr_debug("%s: total packets: %llu\n", __func__, pkts);
+
+		priv->r->pie_rule_write(priv, r->pr.id, &r->pr);
+	}
+}
+
 /* Updates an L3 next hop entry in the ROUTING table */
 static int otto_l3_nexthop_update(struct rtl838x_switch_priv *priv, __be32 ip_addr, u64 mac)
 {
@@ -170,61 +247,31 @@ static int otto_l3_nexthop_update(struct rtl838x_switch_priv *priv, __be32 ip_ad
 	rhl_for_each_entry_rcu(r, tmp, list, linkage) {
 		pr_debug("%s: Setting up fwding: ip %pI4, GW mac %016llx\n",
 			 __func__, &ip_addr, mac);
+		otto_l3_route_hw_update(priv, r, mac);
+	}
+	rcu_read_unlock();
 
-		/* Reads the ROUTING table entry associated with the route */
-		priv->r->route_read(r->id, r);
-		pr_debug("Route with id %d to %pI4 / %d\n", r->id, &r->dst_ip, r->prefix_len);
-
-		r->nh.mac = r->nh.gw = mac;
-		r->nh.port = priv->r->port_ignore;
-		r->nh.id = r->id;
-
-		/* Do we need to explicitly add a DMAC entry with the route's nh index? */
-		if (priv->r->set_l3_egress_mac)
-			priv->r->set_l3_egress_mac(r->id, mac);
-
-		/* Update ROUTING table: map gateway-mac and switch-mac id to route id */
-		rtl83xx_l2_nexthop_add(priv, &r->nh);
-
-		r->attr.valid = true;
-		r->attr.action = ROUTE_ACT_FORWARD;
-		r->attr.type = 0;
-		r->attr.hit = false; /* Reset route-used indicator */
-
-		/* Add PIE entry with dst_ip and prefix_len */
-		r->pr.dip = r->dst_ip;
-		r->pr.dip_m = inet_make_mask(r->prefix_len);
-
-		if (r->is_host_route) {
-			int slot = priv->r->find_l3_slot(r, false);
-
-			pr_info("%s: Got slot for route: %d\n", __func__, slot);
-			priv->r->host_route_write(slot, r);
-		} else {
-			priv->r->route_write(r->id, r);
-			r->pr.fwd_sel = true;
-			r->pr.fwd_data = r->nh.l2_id;
-			r->pr.fwd_act = PIE_ACT_ROUTE_UC;
-		}
-
-		if (priv->r->set_l3_nexthop)
-			priv->r->set_l3_nexthop(r->nh.id, r->nh.l2_id, r->nh.if_id);
+	return 0;
+}
 
-		if (r->pr.id < 0) {
-			r->pr.packet_cntr = rtl83xx_packet_cntr_alloc(priv);
-			if (r->pr.packet_cntr >= 0) {
-				pr_info("Using packet counter %d\n", r->pr.packet_cntr);
-				r->pr.log_sel = true;
-				r->pr.log_data = r->pr.packet_cntr;
-			}
-			priv->r->pie_rule_add(priv, &r->pr);
-		} else {
-			int pkts = priv->r->packet_cntr_read(r->pr.packet_cntr);
+/* Updates the L3 next hop entries of all IPv6 routes via the given gateway */
+static int otto_l3_nexthop_update6(struct rtl838x_switch_priv *priv,
+				   const struct in6_addr *ip6_addr, u64 mac)
+{
+	struct otto_l3_route *r;
+	struct rhlist_head *tmp, *list;
 
-			pr_debug("%s: total packets: %d\n", __func__, pkts);
+	rcu_read_lock();
+	list = rhltable_lookup(&priv->routes6, ip6_addr, otto_l3_route6_ht_params);
+	if (!list) {
+		rcu_read_unlock();
+		return -ENOENT;
+	}
 
-			priv->r->pie_rule_write(priv, r->pr.id, &r->pr);
-		}
+	rhl_for_each_entry_rcu(r, tmp, list, linkage) {
+		pr_debug("%s: Setting up fwding: ip %pI6, GW mac %016llx\n",
+			 __func__, ip6_addr, mac);
+		otto_l3_route_hw_update(priv, r, mac);
 	}
 	rcu_read_unlock();
 
@@ -262,26 +309,64 @@ static int otto_l3_port_ipv4_resolve(struct rtl838x_switch_priv *priv,
 	return err;
 }
 
+static int otto_l3_port_ipv6_resolve(struct rtl838x_switch_priv *priv,
+				     struct net_device *dev, const struct in6_addr *ip6_addr)
+{
+	struct neighbour *n = neigh_lookup(&nd_tbl, ip6_addr, dev);
+	u64 mac;
+
+	if (!n) {
+		n = neigh_create(&nd_tbl, ip6_addr, dev);
+		if (IS_ERR(n))
+			return PTR_ERR(n);
+	}
+
+	/* Same as for IPv4: install the entry right away if the neigh is already
+	 * resolved, otherwise kick off neighbour discovery and wait for the
+	 * netevent notifier to report the result.
+	 */
+	if (n->nud_state & NUD_VALID) {
+		mac = ether_addr_to_u64(n->ha);
+		pr_info("%s: resolved mac: %016llx\n", __func__, mac);
+		otto_l3_nexthop_update6(priv, ip6_addr, mac);
+	} else {
+		pr_info("%s: need to wait\n", __func__);
+		neigh_event_send(n, NULL);
+	}
+
+	neigh_release(n);
+
+	return 0;
+}
+
 static void otto_l3_route_remove(struct rtl838x_switch_priv *priv, struct otto_l3_route *r)
 {
-	int id;
+	int id, err;
 
-	if (rhltable_remove(&priv->routes, &r->linkage, otto_l3_route_ht_params))
+	if (r->is_ipv6)
+		err = rhltable_remove(&priv->routes6, &r->linkage, otto_l3_route6_ht_params);
+	else
+		err = rhltable_remove(&priv->routes, &r->linkage, otto_l3_route_ht_params);
+	if (err)
 		dev_warn(priv->dev, "Could not remove route\n");
 
 	if (r->is_host_route) {
-		id = priv->r->find_l3_slot(r, false);
+		id = priv->r->find_l3_slot(r, true);
 		pr_debug("%s: Got id for host route: %d\n", __func__, id);
-		r->attr.valid = false;
-		priv->r->host_route_write(id, r);
+		if (id >= 0) {
+			r->attr.valid = false;
+			priv->r->host_route_write(id, r);
+		}
 		clear_bit(r->id - MAX_ROUTES, priv->host_route_use_bm);
 	} else {
 		/* If there is a HW representation of the route, delete it */
 		if (priv->r->route_lookup_hw) {
 			id = priv->r->route_lookup_hw(r);
 			pr_info("%s: Got id for prefix route: %d\n", __func__, id);
-			r->attr.valid = false;
-			priv->r->route_write(id, r);
+			if (id >= 0) {
+				r->attr.valid = false;
+				priv->r->route_write(id, r);
+			}
 		}
 		clear_bit(r->id, priv->route_use_bm);
 	}
@@ -289,7 +374,26 @@ static void otto_l3_route_remove(struct rtl838x_switch_priv *priv, struct otto_l
 	kfree(r);
 }
 
-static struct otto_l3_route *otto_l3_host_route_alloc(struct rtl838x_switch_priv *priv, u32 ip)
+/* Sets the gateway key of a new route and links it into the hashtable of its family */
+static int otto_l3_route_insert(struct rtl838x_switch_priv *priv, struct otto_l3_route *r,
+				u32 ip, const struct in6_addr *ip6)
+{
+	if (ip6) {
+		r->gw_ip6 = *ip6;
+		r->is_ipv6 = true;
+		r->attr.type = OTTO_L3_ROUTE_IP6_UC;
+
+		return rhltable_insert(&priv->routes6, &r->linkage, otto_l3_route6_ht_params);
+	}
+
+	r->gw_ip = ip;
+	r->attr.type = OTTO_L3_ROUTE_IP4_UC;
+
+	return rhltable_insert(&priv->routes, &r->linkage, otto_l3_route_ht_params);
+}
+
+static struct otto_l3_route *otto_l3_host_route_alloc(struct rtl838x_switch_priv *priv, u32 ip,
+						       const struct in6_addr *ip6)
 {
 	struct otto_l3_route *r;
 	int idx = 0, err;
@@ -297,7 +401,10 @@ static struct otto_l3_route *otto_l3_host_route_alloc(struct rtl838x_switch_priv
 	mutex_lock(&priv->reg_mutex);
 
 	idx = find_first_zero_bit(priv->host_route_use_bm, MAX_HOST_ROUTES);
-	pr_debug("%s id: %d, ip %pI4\n", __func__, idx, &ip);
+	if (ip6)
+		pr_debug("%s id: %d, ip %pI6\n", __func__, idx, ip6);
+	else
+		pr_debug("%s id: %d, ip %pI4\n", __func__, idx, &ip);
 
 	r = kzalloc(sizeof(*r), GFP_KERNEL);
 	if (!r) {
@@ -310,11 +417,10 @@ static struct otto_l3_route *otto_l3_host_route_alloc(struct rtl838x_switch_priv
 	 */
 	r->id = idx + MAX_ROUTES;
 
-	r->gw_ip = ip;
 	r->pr.id = -1; /* We still need to allocate a rule in HW */
 	r->is_host_route = true;
 
-	err = rhltable_insert(&priv->routes, &r->linkage, otto_l3_route_ht_params);
+	err = otto_l3_route_insert(priv, r, ip, ip6);
 	if (err) {
 		pr_err("Could not insert new rule\n");
 		mutex_unlock(&priv->reg_mutex);
@@ -333,7 +439,8 @@ out_free:
 	return NULL;
 }
 
-static struct otto_l3_route *otto_l3_route_alloc(struct rtl838x_switch_priv *priv, u32 ip)
+static struct otto_l3_route *otto_l3_route_alloc(struct rtl838x_switch_priv *priv, u32 ip,
+						  const struct in6_addr *ip6)
 {
 	struct otto_l3_route *r;
 	int idx = 0, err;
@@ -341,7 +448,10 @@ static struct otto_l3_route *otto_l3_route_alloc(struct rtl838x_switch_priv *pri
 	mutex_lock(&priv->reg_mutex);
 
 	idx = find_first_zero_bit(priv->route_use_bm, MAX_ROUTES);
-	pr_debug("%s id: %d, ip %pI4\n", __func__, idx, &ip);
+	if (ip6)
+		pr_debug("%s id: %d, ip %pI6\n", __func__, idx, ip6);
+	else
+		pr_debug("%s id: %d, ip %pI4\n", __func__, idx, &ip);
 
 	r = kzalloc(sizeof(*r), GFP_KERNEL);
 	if (!r) {
@@ -350,11 +460,10 @@ static struct otto_l3_route *otto_l3_route_alloc(struct rtl838x_switch_priv *pri
 	}
 
 	r->id = idx;
-	r->gw_ip = ip;
 	r->pr.id = -1; /* We still need to allocate a rule in HW */
 	r->is_host_route = false;
 
-	err = rhltable_insert(&priv->routes, &r->linkage, otto_l3_route_ht_params);
+	err = otto_l3_route_insert(priv, r, ip, ip6);
 	if (err) {
 		pr_err("Could not insert new rule\n");
 		mutex_unlock(&priv->reg_mutex);
@@ -417,9 +526,9 @@ static int otto_l3_fib_add_v4(struct rtl838x_switch_priv *priv,
 
 	/* Allocate route or host-route entry (if hardware supports this) */
 	if (info->dst_len == 32 && priv->r->host_route_write)
-		route = otto_l3_host_route_alloc(priv, nh->fib_nh_gw4);
+		route = otto_l3_host_route_alloc(priv, nh->fib_nh_gw4, NULL);
 	else
-		route = otto_l3_route_alloc(priv, nh->fib_nh_gw4);
+		route = otto_l3_route_alloc(priv, nh->fib_nh_gw4, NULL);
 
 	if (route)
 		dev_info(priv->dev, "route hashtable extended for gw %pI4\n", &nh->fib_nh_gw4);
@@ -501,7 +610,7 @@ static int otto_l3_fib_del_v4(struct rtl838x_switch_priv *priv,
 	rtl83xx_l2_nexthop_rm(priv, &route->nh);
 
 	dev_info(priv->dev, "releasing packet counter %d\n", route->pr.packet_cntr);
-	set_bit(route->pr.packet_cntr, priv->packet_cntr_use_bm);
+	rtl83xx_packet_cntr_free(priv, route->pr.packet_cntr);
 	priv->r->pie_rule_rm(priv, &route->pr);
 
 	otto_l3_route_remove(priv, route);
@@ -511,15 +620,194 @@ static int otto_l3_fib_del_v4(struct rtl838x_switch_priv *priv,
 	return 0;
 }
 
+static int otto_l3_fib_check_v6(struct rtl838x_switch_priv *priv,
+				struct fib6_entry_notifier_info *info,
+				enum fib_event_type event)
+{
+	struct fib6_info *rt = info->rt;
+	struct net_device *ndev;
+	char gw_message[64] = "";
+	struct fib6_nh *nh;
+	int addr_type, vlan;
+
+	/* Routes using nexthop objects carry no fib6_nh of their own */
+	if (rt->nh) {
+		dev_warn(priv->dev, "skip IPv6 routes using nexthop objects\n");
+		return -EOPNOTSUPP;
+	}
+
+	nh = rt->fib6_nh;
+	ndev = nh->fib_nh_dev;
+	vlan = is_vlan_dev(ndev) ? vlan_dev_vlan_id(ndev) : 0;
+
+	if (nh->fib_nh_gw_family == AF_INET6)
+		snprintf(gw_message, sizeof(gw_message), "via %pI6 ", &nh->fib_nh_gw6);
+
+	dev_info(priv->dev, "%s IPv6 route %pI6/%d %s(VLAN %d, MAC %pM)\n",
+		 event == FIB_EVENT_ENTRY_DEL ? "delete" : "add",
+		 &rt->fib6_dst.addr, rt->fib6_dst.plen, gw_message, vlan, ndev->dev_addr);
+
+	if (rt->fib6_type != RTN_UNICAST && rt->fib6_type != RTN_LOCAL) {
+		dev_warn(priv->dev, "skip non-unicast IPv6 routes\n");
+		return -EINVAL;
+	}
+
+	addr_type = ipv6_addr_type(&rt->fib6_dst.addr);
+	if ((addr_type & (IPV6_ADDR_LOOPBACK | IPV6_ADDR_LINKLOCAL | IPV6_ADDR_MULTICAST)) ||
+	    !rt->fib6_dst.plen) {
+		dev_warn(priv->dev, "skip loopback/link-local/multicast addresses and default routes\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static int otto_l3_fib_add_v6(struct rtl838x_switch_priv *priv,
-			    struct fib6_entry_notifier_info *info)
+			      struct fib6_entry_notifier_info *info)
 {
-	pr_debug("In %s\n", __func__);
-/*	nh->fib_nh_flags |= RTNH_F_OFFLOAD; */
+	struct fib6_info *rt = info->rt;
+	struct otto_l3_route *route;
+	const struct in6_addr *gw;
+	struct net_device *ndev;
+	struct fib6_nh *nh;
+	int port, vlan;
+
+	if (otto_l3_fib_check_v6(priv, info, FIB_EVENT_ENTRY_ADD))
+		return 0;
+
+	nh = rt->fib6_nh;
+	ndev = nh->fib_nh_dev;
+	vlan = is_vlan_dev(ndev) ? vlan_dev_vlan_id(ndev) : 0;
+	/* Directly connected routes are keyed on the unspecified address */
+	gw = nh->fib_nh_gw_family == AF_INET6 ? &nh->fib_nh_gw6 : &in6addr_any;
+
+	port = otto_l3_port_dev_lower_find(ndev, priv);
+	if (port < 0) {
+		dev_err(priv->dev, "lower interface %s not found\n", ndev->name);
+		return -ENODEV;
+	}
+
+	/* Allocate route or host-route entry (if hardware supports this) */
+	if (rt->fib6_dst.plen == 128 && priv->r->host_route_write)
+		route = otto_l3_host_route_alloc(priv, 0, gw);
+	else
+		route = otto_l3_route_alloc(priv, 0, gw);
+
+	if (route) {
+		dev_info(priv->dev, "route hashtable extended for gw %pI6\n", gw);
+	} else {
+		dev_err(priv->dev, "could not extend route hashtable for gw %pI6\n", gw);
+		return -ENOSPC;
+	}
+
+	route->dst_ip6 = rt->fib6_dst.addr;
+	route->prefix_len = rt->fib6_dst.plen;
+	route->nh.rvid = vlan;
+
+	if (priv->r->set_l3_router_mac) {
+		u64 mac = ether_addr_to_u64(ndev->dev_addr);
+
+		pr_debug("Local route and router MAC %pM\n", ndev->dev_addr);
+		if (otto_l3_alloc_router_mac(priv, mac))
+			return 0;
+
+		route->nh.if_id = otto_l3_alloc_egress_intf(priv, mac, vlan);
+		if (route->nh.if_id < 0)
+			return 0;
+
+		/* Without a gateway, trap packets to the CPU so that the kernel can do neighbour
+		 * discovery for the destination
+		 */
+		if (ipv6_addr_any(gw)) {
+			int slot;
+
+			route->nh.mac = mac;
+			route->nh.port = priv->r->port_ignore;
+			route->attr.valid = true;
+			route->attr.action = ROUTE_ACT_TRAP2CPU;
+
+			if (route->is_host_route) {
+				slot = priv->r->find_l3_slot(route, false);
+				pr_debug("%s: Got slot for route: %d\n", __func__, slot);
+				if (slot >= 0)
+					priv->r->host_route_write(slot, route);
+			} else {
+				priv->r->route_write(route->id, route);
+			}
+		}
+	}
+
+	/* We need to resolve the mac address of the GW */
+	if (!ipv6_addr_any(gw))
+		otto_l3_port_ipv6_resolve(priv, ndev, gw);
+
+	nh->fib_nh_flags |= RTNH_F_OFFLOAD;
+
+	return 0;
+}
+
+static int otto_l3_fib_del_v6(struct rtl838x_switch_priv *priv,
+			      struct fib6_entry_notifier_info *info)
+{
+	struct fib6_info *rt = info->rt;
+	struct otto_l3_route *route, *found = NULL;
+	struct rhlist_head *tmp, *list;
+	const struct in6_addr *gw;
+	struct fib6_nh *nh;
+
+	if (otto_l3_fib_check_v6(priv, info, FIB_EVENT_ENTRY_DEL))
+		return 0;
+
+	nh = rt->fib6_nh;
+	gw = nh->fib_nh_gw_family == AF_INET6 ? &nh->fib_nh_gw6 : &in6addr_any;
+
+	rcu_read_lock();
+	list = rhltable_lookup(&priv->routes6, gw, otto_l3_route6_ht_params);
+	rhl_for_each_entry_rcu(route, tmp, list, linkage) {
+		if (ipv6_addr_equal(&route->dst_ip6, &rt->fib6_dst.addr) &&
+		    route->prefix_len == rt->fib6_dst.plen) {
+			dev_info(priv->dev, "found a route with id %d, nh-id %d\n",
+				 route->id, route->nh.id);
+			found = route;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	if (!found) {
+		dev_err(priv->dev, "no route to %pI6/%d via gateway %pI6\n",
+			&rt->fib6_dst.addr, rt->fib6_dst.plen, gw);
+		return -ENOENT;
+	}
+
+	rtl83xx_l2_nexthop_rm(priv, &found->nh);
+
+	if (found->pr.id >= 0) {
+		if (found->pr.packet_cntr >= 0) {
+			dev_info(priv->dev, "releasing packet counter %d\n", found->pr.packet_cntr);
+			rtl83xx_packet_cntr_free(priv, found->pr.packet_cntr);
+		}
+		priv->r->pie_rule_rm(priv, &found->pr);
+	}
+
+	otto_l3_route_remove(priv, found);
+
+	nh->fib_nh_flags &= ~RTNH_F_OFFLOAD;
 
 	return 0;
 }
 
+/* Lets the compiler drop all IPv6 paths when IPv6 is disabled */
+static bool otto_l3_fib_work_is_v6(const struct otto_l3_fib_event_work *fib_work)
+{
+	return IS_ENABLED(CONFIG_IPV6) && fib_work->is_fib6;
+}
+
+static bool otto_l3_neigh_is_nd(const struct neighbour *n)
+{
+	return IS_ENABLED(CONFIG_IPV6) && n->tbl == &nd_tbl;
+}
+
 static void otto_l3_fib_event_work_do(struct work_struct *work)
 {
 	struct otto_l3_fib_event_work *fib_work =
@@ -535,21 +823,30 @@ static void otto_l3_fib_event_work_do(struct work_struct *work)
 	case FIB_EVENT_ENTRY_ADD:
 	case FIB_EVENT_ENTRY_REPLACE:
 	case FIB_EVENT_ENTRY_APPEND:
-		if (fib_work->is_fib6)
+		if (otto_l3_fib_work_is_v6(fib_work))
 			err = otto_l3_fib_add_v6(priv, &fib_work->fen6_info);
 		else
 			err = otto_l3_fib_add_v4(priv, &fib_work->fen_info);
 		if (err)
 			dev_err(priv->dev, "fib_add() failed\n");
 
-		fib_info_put(fib_work->fen_info.fi);
+		if (otto_l3_fib_work_is_v6(fib_work))
+			fib6_info_release(fib_work->fen6_info.rt);
+		else
+			fib_info_put(fib_work->fen_info.fi);
 		break;
 	case FIB_EVENT_ENTRY_DEL:
-		err = otto_l3_fib_del_v4(priv, &fib_work->fen_info);
+		if (otto_l3_fib_work_is_v6(fib_work))
+			err = otto_l3_fib_del_v6(priv, &fib_work->fen6_info);
+		else
+			err = otto_l3_fib_del_v4(priv, &fib_work->fen_info);
 		if (err)
 			dev_err(priv->dev, "fib_del() failed\n");
 
-		fib_info_put(fib_work->fen_info.fi);
+		if (otto_l3_fib_work_is_v6(fib_work))
+			fib6_info_release(fib_work->fen6_info.rt);
+		else
+			fib_info_put(fib_work->fen_info.fi);
 		break;
 	case FIB_EVENT_RULE_ADD:
 	case FIB_EVENT_RULE_DEL:
@@ -612,9 +909,20 @@ static int otto_l3_fib_notifier(struct notifier_block *this, unsigned long event
 			 */
 			fib_info_hold(fib_work->fen_info.fi);
 
-		} else if (info->family == AF_INET6) {
-			//struct fib6_entry_notifier_info *fen6_info = ptr;
-			pr_warn("%s: FIB_RULE ADD/DEL for IPv6 not supported\n", __func__);
+		} else if (IS_ENABLED(CONFIG_IPV6) && info->family == AF_INET6) {
+			struct fib6_entry_notifier_info *fen6_info = ptr;
+
+			if (fen6_info->nsiblings) {
+				pr_debug("%s: IPv6 multipath routes are not offloaded\n", __func__);
+				kfree(fib_work);
+				return NOTIFY_DONE;
+			}
+
+			memcpy(&fib_work->fen6_info, ptr, sizeof(fib_work->fen6_info));
+			/* Same as for IPv4, hold the fib6_info while the work is queued */
+			fib6_info_hold(fib_work->fen6_info.rt);
+			fib_work->is_fib6 = true;
+		} else {
 			kfree(fib_work);
 			return NOTIFY_DONE;
 		}
@@ -639,7 +947,10 @@ static void otto_l3_net_event_work_do(struct work_struct *work)
 		container_of(work, struct otto_l3_net_event_work, work);
 	struct rtl838x_switch_priv *priv = net_work->priv;
 
-	otto_l3_nexthop_update(priv, net_work->gw_addr, net_work->mac);
+	if (net_work->is_ipv6)
+		otto_l3_nexthop_update6(priv, &net_work->gw_addr6, net_work->mac);
+	else
+		otto_l3_nexthop_update(priv, net_work->gw_addr, net_work->mac);
 
 	kfree(net_work);
 }
@@ -659,7 +970,7 @@ static int otto_l3_netevent_notifier(struct notifier_block *this, unsigned long
 		if (!priv->r->l3_setup)
 			return NOTIFY_DONE;
 
-		if (n->tbl != &arp_tbl)
+		if (n->tbl != &arp_tbl && !otto_l3_neigh_is_nd(n))
 			return NOTIFY_DONE;
 		dev = n->dev;
 		port = otto_l3_port_dev_lower_find(dev, priv);
@@ -676,7 +987,12 @@ static int otto_l3_netevent_notifier(struct notifier_block *this, unsigned long
 		net_work->priv = priv;
 
 		net_work->mac = ether_addr_to_u64(n->ha);
-		net_work->gw_addr = *(__be32 *)n->primary_key;
+		if (otto_l3_neigh_is_nd(n)) {
+			net_work->gw_addr6 = *(struct in6_addr *)n->primary_key;
+			net_work->is_ipv6 = true;
+		} else {
+			net_work->gw_addr = *(__be32 *)n->primary_key;
+		}
 
 		pr_debug("%s: updating neighbour on port %d, mac %016llx\n",
 			 __func__, port, net_work->mac);
@@ -716,6 +1032,7 @@ int otto_l3_probe(struct device *dev, struct rtl838x_switch_priv *priv)
 
 	/* Initialize hash table for L3 routing */
 	rhltable_init(&priv->routes, &otto_l3_route_ht_params);
+	rhltable_init(&priv->routes6, &otto_l3_route6_ht_params);
 
 	/*
 	 * Register netevent notifier callback to catch notifications about neighboring changes
@@ -11,6 +11,10 @@ struct otto_l3_ctrl {
 	struct notifier_block ne_nb;
 };
 
+/* Entry types of the L3 host and prefix route tables */
+#define OTTO_L3_ROUTE_IP4_UC	0
+#define OTTO_L3_ROUTE_IP6_UC	2
+
 struct otto_l3_route_attr {
 	bool valid;
 	bool hit;
@@ -39,9 +43,11 @@ struct otto_l3_nexthop {
 struct otto_l3_route {
 	u32 gw_ip;			/* IP of the route's gateway */
 	u32 dst_ip;			/* IP of the destination net */
-	struct in6_addr dst_ip6;
+	struct in6_addr gw_ip6;		/* IPv6 of the route's gateway */
+	struct in6_addr dst_ip6;	/* IPv6 of the destination net */
 	int prefix_len;			/* Network prefix len of the destination net */
 	bool is_host_route;
+	bool is_ipv6;			/* Route is kept in the IPv6 hashtable */
 	int id;				/* ID number of this route */
 	struct rhlist_head linkage;
 	u16 switch_mac_id;		/* Index into switch's own MACs, RTL839X only */
@@ -56,6 +62,12 @@ static const struct rhashtable_params otto_l3_route_ht_params = {
 	.head_offset = offsetof(struct otto_l3_route, linkage),
 };
 
+static const struct rhashtable_params otto_l3_route6_ht_params = {
+	.key_len     = sizeof(struct in6_addr),
+	.key_offset  = offsetof(struct otto_l3_route, gw_ip6),
+	.head_offset = offsetof(struct otto_l3_route, linkage),
+};
+
 int otto_l3_probe(struct device *dev, struct rtl838x_switch_priv *priv);
 void otto_l3_remove(struct rtl838x_switch_priv *priv);
 
@@ -848,6 +848,7 @@ typedef enum {
 #define RTL931X_LED_SET_LEDX_SHIFT(x) (16 * (x % 2))
 
 #define MAX_VLANS 4096
+#define L2_READ_BATCH 64
 #define MAX_LAGS 16
 #define MAX_PRIOS 8
 #define RTL930X_PORT_IGNORE 0x3f
@@ -872,6 +873,7 @@ typedef enum {
 #define MAX_COUNTERS 2048
 #define MAX_ROUTES 512
 #define MAX_HOST_ROUTES 1536
+#define MAX_HOST_ROUTE_SLOTS (2 * 512 * 6)	/* 2 hash tables, 512 buckets of 6 slots */
 #define MAX_INTF_MTUS 8
 #define DEFAULT_MTU 1536
 #define MAX_INTERFACES 100
@@ -1129,11 +1131,12 @@ struct pie_rule {
 	enum pie_phase phase;	/* Phase in which this template is applied */
 	int packet_cntr;	/* ID of a packet counter assigned to this rule */
 	int octet_cntr;		/* ID of a byte counter assigned to this rule */
-	u32 last_packet_cnt;
+	u64 last_packet_cnt;
 	u64 last_octet_cnt;
 
 	/* The following are requirements for the pie template */
 	bool is_egress;
+	int min_block;		/* Lowest PIE block the rule may be placed in */
 	bool is_ipv6;		/* This is a rule with IPv6 fields */
 
 	/* Fixed fields that are always matched against on RTL8380 */
@@ -1312,6 +1315,8 @@ struct rtl83xx_flow {
 	struct rcu_head rcu_head;
 	struct rtl838x_switch_priv *priv;
 	struct pie_rule rule;
+	struct pie_rule octet_rule;	/* Rule counting the bytes of the flow */
+	unsigned long lastused;
 	u32 flags;
 };
 
@@ -1419,6 +1424,7 @@ struct rtldsa_config {
 	u64 (*read_l2_entry_using_hash)(u32 hash, u32 position, struct rtl838x_l2_entry *e);
 	void (*write_l2_entry_using_hash)(u32 hash, u32 pos, struct rtl838x_l2_entry *e);
 	u64 (*read_cam)(int idx, struct rtl838x_l2_entry *e);
+	void (*read_l2_entries)(int idx, int n, struct rtl838x_l2_entry *e);
 	void (*write_cam)(int idx, struct rtl838x_l2_entry *e);
 	int rma_bpdu_fld_pmask;
 	int spcl_trap_eapol_ctrl;
@@ -1437,8 +1443,10 @@ struct rtldsa_config {
 	void (*l2_learning_setup)(void);
 	u32 (*packet_cntr_read)(int counter);
 	void (*packet_cntr_clear)(int counter);
+	void (*log_table_read)(int idx, int n, u32 *data);
 	void (*route_read)(int idx, struct otto_l3_route *rt);
 	void (*route_write)(int idx, struct otto_l3_route *rt);
+	void (*host_route_read)(int idx, struct otto_l3_route *rt);
 	void (*host_route_write)(int idx, struct otto_l3_route *rt);
 	int (*l3_setup)(struct rtl838x_switch_priv *priv);
 	void (*set_l3_nexthop)(int idx, u16 dmac_id, u16 interface);
@@ -1510,7 +1518,16 @@ struct rtl838x_switch_priv {
 	unsigned long pie_use_bm[MAX_PIE_ENTRIES >> 5];
 	unsigned long octet_cntr_use_bm[MAX_COUNTERS >> 5];
 	unsigned long packet_cntr_use_bm[MAX_COUNTERS >> 4];
+	unsigned long log_octet_bm[MAX_COUNTERS >> 5];	/* LOG entries used as octet counter */
+	struct mutex vlan_cache_lock;
+	struct rtl838x_vlan_info *vlan_cache;	/* Shadow copy of the VLAN table */
+	unsigned long vlan_cache_valid[BITS_TO_LONGS(MAX_VLANS)];
+	u64 *log_cntrs;		/* 64-bit copies of the LOG table counters, by packet counter id */
+	spinlock_t log_cntrs_lock;
+	struct delayed_work log_cntrs_work;
+	int log_cntrs_users;	/* Counters allocated, the poller only runs while > 0 */
 	struct rhltable routes;
+	struct rhltable routes6;
 	unsigned long route_use_bm[MAX_ROUTES >> 5];
 	unsigned long host_route_use_bm[MAX_HOST_ROUTES >> 5];
 	struct rtl838x_l3_intf *interfaces[MAX_INTERFACES];
@@ -1662,6 +1679,19 @@ void rtldsa_839x_qos_init(struct rtl838x_switch_priv *priv);
 
 void rtldsa_port_fast_age(struct dsa_switch *ds, int port);
 int rtl83xx_packet_cntr_alloc(struct rtl838x_switch_priv *priv);
+void rtldsa_l2_read_batch(struct rtl838x_switch_priv *priv, int idx, int n,
+			  struct rtl838x_l2_entry *e);
+void rtldsa_vlan_tables_read(struct rtl838x_switch_priv *priv, u32 vlan,
+			     struct rtl838x_vlan_info *info);
+void rtldsa_vlan_set_tagged(struct rtl838x_switch_priv *priv, u32 vlan,
+			    struct rtl838x_vlan_info *info);
+void rtldsa_vlan_set_untagged(struct rtl838x_switch_priv *priv, u32 vlan, u64 portmask);
+int rtl83xx_octet_cntr_alloc(struct rtl838x_switch_priv *priv);
+void rtl83xx_packet_cntr_free(struct rtl838x_switch_priv *priv, int idx);
+void rtl83xx_octet_cntr_free(struct rtl838x_switch_priv *priv, int idx);
+u64 rtl83xx_packet_cntr_get(struct rtl838x_switch_priv *priv, int idx);
+u64 rtl83xx_octet_cntr_get(struct rtl838x_switch_priv *priv, int idx);
+int rtl83xx_log_cntrs_init(struct rtl838x_switch_priv *priv);
 int rtldsa_port_get_stp_state(struct rtl838x_switch_priv *priv, int port);
 int rtl83xx_port_is_under(const struct net_device *dev, struct rtl838x_switch_priv *priv);
 void rtldsa_port_stp_state_set(struct dsa_switch *ds, int port, u8 state);
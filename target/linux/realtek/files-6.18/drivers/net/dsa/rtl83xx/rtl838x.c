@@ -477,6 +477,24 @@ static u64 rtl838x_read_l2_entry_using_hash(u32 hash, u32 pos, struct rtl838x_l2
 	return (((u64)r[1]) << 32) | (r[2]);  /* mac and vid concatenated as hash seed */
 }
 
+/* Read n consecutive entries of the L2 forwarding table starting at index idx
+ * while holding the table for the whole batch
+ */
+static void rtl838x_read_l2_entries(int idx, int n, struct rtl838x_l2_entry *e)
+{
+	u32 r[3];
+	struct table_reg *q = rtl_table_get(RTL8380_TBL_L2, 0);
+
+	for (int j = 0; j < n; j++) {
+		rtl_table_read(q, idx + j);
+		for (int i = 0; i < 3; i++)
+			r[i] = sw_r32(rtl_table_data(q, i));
+		rtl838x_fill_l2_entry(r, &e[j]);
+	}
+
+	rtl_table_release(q);
+}
+
 static void rtl838x_write_l2_entry_using_hash(u32 hash, u32 pos, struct rtl838x_l2_entry *e)
 {
 	u32 r[3];
@@ -1505,7 +1523,7 @@ static int rtl838x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 
 	mutex_lock(&priv->pie_mutex);
 
-	for (block = 0; block < priv->r->n_pie_blocks; block++) {
+	for (block = pr->min_block; block < priv->r->n_pie_blocks; block++) {
 		for (j = 0; j < 3; j++) {
 			int t = (sw_r32(RTL838X_ACL_BLK_TMPLTE_CTRL(block)) >> (j * 3)) & 0x7;
 
@@ -1628,6 +1646,21 @@ static void rtl838x_packet_cntr_clear(int counter)
 	rtl_table_release(r);
 }
 
+static void rtl838x_log_table_read(int idx, int n, u32 *data)
+{
+	/* Read LOG table (3) via register RTL8380_TBL_0 */
+	struct table_reg *r = rtl_table_get(RTL8380_TBL_0, 3);
+
+	for (int i = 0; i < n; i++) {
+		rtl_table_read(r, idx + i);
+		/* The table has a size of 2 registers */
+		data[i * 2] = sw_r32(rtl_table_data(r, 0));
+		data[i * 2 + 1] = sw_r32(rtl_table_data(r, 1));
+	}
+
+	rtl_table_release(r);
+}
+
 static void rtl838x_route_read(int idx, struct otto_l3_route *rt)
 {
 	/* Read ROUTING table (2) via register RTL8380_TBL_1 */
@@ -1852,6 +1885,7 @@ const struct rtldsa_config rtldsa_838x_cfg = {
 	.get_mirror_config = rtldsa_838x_get_mirror_config,
 	.print_matrix = rtldsa_838x_print_matrix,
 	.read_l2_entry_using_hash = rtl838x_read_l2_entry_using_hash,
+	.read_l2_entries = rtl838x_read_l2_entries,
 	.write_l2_entry_using_hash = rtl838x_write_l2_entry_using_hash,
 	.read_cam = rtl838x_read_cam,
 	.write_cam = rtl838x_write_cam,
@@ -1876,6 +1910,7 @@ const struct rtldsa_config rtldsa_838x_cfg = {
 	.l2_learning_setup = rtl838x_l2_learning_setup,
 	.packet_cntr_read = rtl838x_packet_cntr_read,
 	.packet_cntr_clear = rtl838x_packet_cntr_clear,
+	.log_table_read = rtl838x_log_table_read,
 	.route_read = rtl838x_route_read,
 	.route_write = rtl838x_route_write,
 	.l3_setup = rtl838x_l3_setup,
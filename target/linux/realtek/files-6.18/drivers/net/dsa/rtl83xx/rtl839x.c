@@ -508,6 +508,24 @@ static u64 rtl839x_read_l2_entry_using_hash(u32 hash, u32 pos, struct rtl838x_l2
 	return rtl839x_l2_hash_seed(ether_addr_to_u64(&e->mac[0]), e->rvid);
 }
 
+/* Read n consecutive entries of the L2 forwarding table starting at index idx
+ * while holding the table for the whole batch
+ */
+static void rtl839x_read_l2_entries(int idx, int n, struct rtl838x_l2_entry *e)
+{
+	u32 r[3];
+	struct table_reg *q = rtl_table_get(RTL8390_TBL_L2, 0);
+
+	for (int j = 0; j < n; j++) {
+		rtl_table_read(q, idx + j);
+		for (int i = 0; i < 3; i++)
+			r[i] = sw_r32(rtl_table_data(q, i));
+		rtl839x_fill_l2_entry(r, &e[j]);
+	}
+
+	rtl_table_release(q);
+}
+
 static void rtl839x_write_l2_entry_using_hash(u32 hash, u32 pos, struct rtl838x_l2_entry *e)
 {
 	u32 r[3];
@@ -1403,6 +1421,7 @@ static int rtl839x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 		min_block = max_block;
 		max_block = priv->r->n_pie_blocks;
 	}
+	min_block = max(min_block, pr->min_block);
 
 	mutex_lock(&priv->pie_mutex);
 
@@ -1417,7 +1436,7 @@ static int rtl839x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 			break;
 	}
 
-	if (block >= priv->r->n_pie_blocks) {
+	if (block >= max_block) {
 		mutex_unlock(&priv->pie_mutex);
 		return -EOPNOTSUPP;
 	}
@@ -1533,6 +1552,21 @@ static void rtl839x_packet_cntr_clear(int counter)
 	rtl_table_release(r);
 }
 
+static void rtl839x_log_table_read(int idx, int n, u32 *data)
+{
+	/* Read LOG table (4) via register RTL8390_TBL_0 */
+	struct table_reg *r = rtl_table_get(RTL8390_TBL_0, 4);
+
+	for (int i = 0; i < n; i++) {
+		rtl_table_read(r, idx + i);
+		/* The table has a size of 2 registers */
+		data[i * 2] = sw_r32(rtl_table_data(r, 0));
+		data[i * 2 + 1] = sw_r32(rtl_table_data(r, 1));
+	}
+
+	rtl_table_release(r);
+}
+
 static void rtl839x_route_read(int idx, struct otto_l3_route *rt)
 {
 	u64 v;
@@ -1771,6 +1805,7 @@ const struct rtldsa_config rtldsa_839x_cfg = {
 	.get_mirror_config = rtldsa_839x_get_mirror_config,
 	.print_matrix = rtldsa_839x_print_matrix,
 	.read_l2_entry_using_hash = rtl839x_read_l2_entry_using_hash,
+	.read_l2_entries = rtl839x_read_l2_entries,
 	.write_l2_entry_using_hash = rtl839x_write_l2_entry_using_hash,
 	.read_cam = rtl839x_read_cam,
 	.write_cam = rtl839x_write_cam,
@@ -1792,6 +1827,7 @@ const struct rtldsa_config rtldsa_839x_cfg = {
 	.l2_learning_setup = rtl839x_l2_learning_setup,
 	.packet_cntr_read = rtl839x_packet_cntr_read,
 	.packet_cntr_clear = rtl839x_packet_cntr_clear,
+	.log_table_read = rtl839x_log_table_read,
 	.route_read = rtl839x_route_read,
 	.route_write = rtl839x_route_write,
 	.l3_setup = rtl839x_l3_setup,
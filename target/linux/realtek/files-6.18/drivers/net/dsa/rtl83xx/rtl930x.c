@@ -889,6 +889,24 @@ static u64 rtl930x_read_l2_entry_using_hash(u32 hash, u32 pos, struct rtl838x_l2
 	return seed;
 }
 
+/* Read n consecutive entries of the L2 forwarding table starting at index idx
+ * while holding the table for the whole batch
+ */
+static void rtl930x_read_l2_entries(int idx, int n, struct rtl838x_l2_entry *e)
+{
+	u32 r[3];
+	struct table_reg *q = rtl_table_get(RTL9300_TBL_L2, 0);
+
+	for (int j = 0; j < n; j++) {
+		rtl_table_read(q, idx + j);
+		for (int i = 0; i < 3; i++)
+			r[i] = sw_r32(rtl_table_data(q, i));
+		rtl930x_fill_l2_entry(r, &e[j]);
+	}
+
+	rtl_table_release(q);
+}
+
 static void rtl930x_write_l2_entry_using_hash(u32 hash, u32 pos, struct rtl838x_l2_entry *e)
 {
 	u32 r[3];
@@ -1212,58 +1230,59 @@ static u32 rtl930x_l3_hash4(u32 ip, int algorithm, bool move_dip)
 	return hash;
 }
 
-// Currently not used
-// static u32 rtl930x_l3_hash6(struct in6_addr *ip6, int algorithm, bool move_dip)
-// {
-// 	u32 rows[16];
-// 	u32 hash;
-// 	u32 s0, s1, pH;
-
-// 	rows[0] = (HASH_PICK(ip6->s6_addr[0], 6, 2) << 0);
-// 	rows[1] = (HASH_PICK(ip6->s6_addr[0], 0, 6) << 3) | HASH_PICK(ip6->s6_addr[1], 5, 3);
-// 	rows[2] = (HASH_PICK(ip6->s6_addr[1], 0, 5) << 4) | HASH_PICK(ip6->s6_addr[2], 4, 4);
-// 	rows[3] = (HASH_PICK(ip6->s6_addr[2], 0, 4) << 5) | HASH_PICK(ip6->s6_addr[3], 3, 5);
-// 	rows[4] = (HASH_PICK(ip6->s6_addr[3], 0, 3) << 6) | HASH_PICK(ip6->s6_addr[4], 2, 6);
-// 	rows[5] = (HASH_PICK(ip6->s6_addr[4], 0, 2) << 7) | HASH_PICK(ip6->s6_addr[5], 1, 7);
-// 	rows[6] = (HASH_PICK(ip6->s6_addr[5], 0, 1) << 8) | HASH_PICK(ip6->s6_addr[6], 0, 8);
-// 	rows[7] = (HASH_PICK(ip6->s6_addr[7], 0, 8) << 1) | HASH_PICK(ip6->s6_addr[8], 7, 1);
-// 	rows[8] = (HASH_PICK(ip6->s6_addr[8], 0, 7) << 2) | HASH_PICK(ip6->s6_addr[9], 6, 2);
-// 	rows[9] = (HASH_PICK(ip6->s6_addr[9], 0, 6) << 3) | HASH_PICK(ip6->s6_addr[10], 5, 3);
-// 	rows[10] = (HASH_PICK(ip6->s6_addr[10], 0, 5) << 4) | HASH_PICK(ip6->s6_addr[11], 4, 4);
-// 	if (!algorithm) {
-// 		rows[11] = (HASH_PICK(ip6->s6_addr[11], 0, 4) << 5) |
-// 			   (HASH_PICK(ip6->s6_addr[12], 3, 5) << 0);
-// 		rows[12] = (HASH_PICK(ip6->s6_addr[12], 0, 3) << 6) |
-// 			   (HASH_PICK(ip6->s6_addr[13], 2, 6) << 0);
-// 		rows[13] = (HASH_PICK(ip6->s6_addr[13], 0, 2) << 7) |
-// 			   (HASH_PICK(ip6->s6_addr[14], 1, 7) << 0);
-// 		if (!move_dip) {
-// 			rows[14] = (HASH_PICK(ip6->s6_addr[14], 0, 1) << 8) |
-// 				   (HASH_PICK(ip6->s6_addr[15], 0, 8) << 0);
-// 		}
-// 		hash = rows[0] ^ rows[1] ^ rows[2] ^ rows[3] ^ rows[4] ^
-// 		       rows[5] ^ rows[6] ^ rows[7] ^ rows[8] ^ rows[9] ^
-// 		       rows[10] ^ rows[11] ^ rows[12] ^ rows[13] ^ rows[14];
-// 	} else {
-// 		rows[11] = (HASH_PICK(ip6->s6_addr[11], 0, 4) << 5);
-// 		rows[12] = (HASH_PICK(ip6->s6_addr[12], 3, 5) << 0);
-// 		rows[13] = (HASH_PICK(ip6->s6_addr[12], 0, 3) << 6) |
-// 			   HASH_PICK(ip6->s6_addr[13], 2, 6);
-// 		rows[14] = (HASH_PICK(ip6->s6_addr[13], 0, 2) << 7) |
-// 			   HASH_PICK(ip6->s6_addr[14], 1, 7);
-// 		if (!move_dip) {
-// 			rows[15] = (HASH_PICK(ip6->s6_addr[14], 0, 1) << 8) |
-// 				   (HASH_PICK(ip6->s6_addr[15], 0, 8) << 0);
-// 		}
-// 		s0 = rows[12] + rows[13] + rows[14];
-// 		s1 = (s0 & 0x1ff) + ((s0 & (0x1ff << 9)) >> 9);
-// 		pH = (s1 & 0x1ff) + ((s1 & (0x1ff << 9)) >> 9);
-// 		hash = rows[0] ^ rows[1] ^ rows[2] ^ rows[3] ^ rows[4] ^
-// 		       rows[5] ^ rows[6] ^ rows[7] ^ rows[8] ^ rows[9] ^
-// 		       rows[10] ^ rows[11] ^ pH ^ rows[15];
-// 	}
-// 	return hash;
-// }
+static u32 rtl930x_l3_hash6(struct in6_addr *ip6, int algorithm, bool move_dip)
+{
+	u32 rows[16];
+	u32 hash;
+	u32 s0, s1, pH;
+
+	memset(rows, 0, sizeof(rows));
+
+	rows[0] = (HASH_PICK(ip6->s6_addr[0], 6, 2) << 0);
+	rows[1] = (HASH_PICK(ip6->s6_addr[0], 0, 6) << 3) | HASH_PICK(ip6->s6_addr[1], 5, 3);
+	rows[2] = (HASH_PICK(ip6->s6_addr[1], 0, 5) << 4) | HASH_PICK(ip6->s6_addr[2], 4, 4);
+	rows[3] = (HASH_PICK(ip6->s6_addr[2], 0, 4) << 5) | HASH_PICK(ip6->s6_addr[3], 3, 5);
+	rows[4] = (HASH_PICK(ip6->s6_addr[3], 0, 3) << 6) | HASH_PICK(ip6->s6_addr[4], 2, 6);
+	rows[5] = (HASH_PICK(ip6->s6_addr[4], 0, 2) << 7) | HASH_PICK(ip6->s6_addr[5], 1, 7);
+	rows[6] = (HASH_PICK(ip6->s6_addr[5], 0, 1) << 8) | HASH_PICK(ip6->s6_addr[6], 0, 8);
+	rows[7] = (HASH_PICK(ip6->s6_addr[7], 0, 8) << 1) | HASH_PICK(ip6->s6_addr[8], 7, 1);
+	rows[8] = (HASH_PICK(ip6->s6_addr[8], 0, 7) << 2) | HASH_PICK(ip6->s6_addr[9], 6, 2);
+	rows[9] = (HASH_PICK(ip6->s6_addr[9], 0, 6) << 3) | HASH_PICK(ip6->s6_addr[10], 5, 3);
+	rows[10] = (HASH_PICK(ip6->s6_addr[10], 0, 5) << 4) | HASH_PICK(ip6->s6_addr[11], 4, 4);
+	if (!algorithm) {
+		rows[11] = (HASH_PICK(ip6->s6_addr[11], 0, 4) << 5) |
+			   (HASH_PICK(ip6->s6_addr[12], 3, 5) << 0);
+		rows[12] = (HASH_PICK(ip6->s6_addr[12], 0, 3) << 6) |
+			   (HASH_PICK(ip6->s6_addr[13], 2, 6) << 0);
+		rows[13] = (HASH_PICK(ip6->s6_addr[13], 0, 2) << 7) |
+			   (HASH_PICK(ip6->s6_addr[14], 1, 7) << 0);
+		if (!move_dip) {
+			rows[14] = (HASH_PICK(ip6->s6_addr[14], 0, 1) << 8) |
+				   (HASH_PICK(ip6->s6_addr[15], 0, 8) << 0);
+		}
+		hash = rows[0] ^ rows[1] ^ rows[2] ^ rows[3] ^ rows[4] ^
+		       rows[5] ^ rows[6] ^ rows[7] ^ rows[8] ^ rows[9] ^
+		       rows[10] ^ rows[11] ^ rows[12] ^ rows[13] ^ rows[14];
+	} else {
+		rows[11] = (HASH_PICK(ip6->s6_addr[11], 0, 4) << 5);
+		rows[12] = (HASH_PICK(ip6->s6_addr[12], 3, 5) << 0);
+		rows[13] = (HASH_PICK(ip6->s6_addr[12], 0, 3) << 6) |
+			   HASH_PICK(ip6->s6_addr[13], 2, 6);
+		rows[14] = (HASH_PICK(ip6->s6_addr[13], 0, 2) << 7) |
+			   HASH_PICK(ip6->s6_addr[14], 1, 7);
+		if (!move_dip) {
+			rows[15] = (HASH_PICK(ip6->s6_addr[14], 0, 1) << 8) |
+				   (HASH_PICK(ip6->s6_addr[15], 0, 8) << 0);
+		}
+		s0 = rows[12] + rows[13] + rows[14];
+		s1 = (s0 & 0x1ff) + ((s0 & (0x1ff << 9)) >> 9);
+		pH = (s1 & 0x1ff) + ((s1 & (0x1ff << 9)) >> 9);
+		hash = rows[0] ^ rows[1] ^ rows[2] ^ rows[3] ^ rows[4] ^
+		       rows[5] ^ rows[6] ^ rows[7] ^ rows[8] ^ rows[9] ^
+		       rows[10] ^ rows[11] ^ pH ^ rows[15];
+	}
+	return hash;
+}
 
 /* Read a prefix route entry from the L3_PREFIX_ROUTE_IPUC table
  * We currently only support IPv4 and IPv6 unicast route
@@ -1308,11 +1327,15 @@ static void rtl930x_route_read(int idx, struct otto_l3_route *rt)
 		ipv6_addr_set(&ip6_m,
 			      sw_r32(rtl_table_data(r, 6)), sw_r32(rtl_table_data(r, 7)),
 			      sw_r32(rtl_table_data(r, 8)), sw_r32(rtl_table_data(r, 9)));
-		rt->prefix_len = host_route ? 128 : 0;
-		rt->prefix_len = (rt->prefix_len < 0 && default_route) ? 0 : -1;
-		if (rt->prefix_len < 0)
-			rt->prefix_len = find_last_bit((unsigned long *)&ip6_m.s6_addr32,
-						       128);
+		if (host_route) {
+			rt->prefix_len = 128;
+		} else if (default_route) {
+			rt->prefix_len = 0;
+		} else {
+			rt->prefix_len = 0;
+			for (int i = 0; i < 4; i++)
+				rt->prefix_len += hweight32(ip6_m.s6_addr32[i]);
+		}
 		break;
 	case 1: /* IPv4 Multicast route */
 	case 3: /* IPv6 Multicast route */
@@ -1343,8 +1366,10 @@ static void rtl930x_net6_mask(int prefix_len, struct in6_addr *ip6_m)
 	/* Define network mask */
 	o = prefix_len >> 3;
 	b = prefix_len & 0x7;
+	memset(ip6_m, 0, sizeof(*ip6_m));
 	memset(ip6_m->s6_addr, 0xff, o);
-	ip6_m->s6_addr[o] |= b ? 0xff00 >> b : 0x00;
+	if (b)
+		ip6_m->s6_addr[o] = 0xff00 >> b;
 }
 
 /* Read a host route entry from the table using its index
@@ -1372,8 +1397,8 @@ static void rtl930x_host_route_read(int idx, struct otto_l3_route *rt)
 		break;
 	case 2: /* IPv6 Unicast route */
 		ipv6_addr_set(&rt->dst_ip6,
-			      sw_r32(rtl_table_data(r, 3)), sw_r32(rtl_table_data(r, 2)),
-			      sw_r32(rtl_table_data(r, 1)), sw_r32(rtl_table_data(r, 0)));
+			      sw_r32(rtl_table_data(r, 1)), sw_r32(rtl_table_data(r, 2)),
+			      sw_r32(rtl_table_data(r, 3)), sw_r32(rtl_table_data(r, 4)));
 		break;
 	case 1: /* IPv4 Multicast route */
 	case 3: /* IPv6 Multicast route */
@@ -1417,7 +1442,7 @@ static void rtl930x_host_route_write(int idx, struct otto_l3_route *rt)
 		 rt->attr.dst_null);
 	pr_debug("%s: GW: %pI4, prefix_len: %d\n", __func__, &rt->dst_ip, rt->prefix_len);
 
-	v = BIT(31); /* Entry is valid */
+	v = rt->attr.valid ? BIT(31) : 0;
 	v |= (rt->attr.type & 0x3) << 29;
 	v |= rt->attr.hit ? BIT(20) : 0;
 	v |= rt->attr.dst_null ? BIT(19) : 0;
@@ -1465,11 +1490,11 @@ static int rtl930x_route_lookup_hw(struct otto_l3_route *rt)
 	if (rt->attr.type == 1 || rt->attr.type == 3) /* Hardware only supports UC routes */
 		return -1;
 
-	sw_w32_mask(0x3 << 19, rt->attr.type, RTL930X_L3_HW_LU_KEY_CTRL);
+	sw_w32_mask(0x3 << 19, rt->attr.type << 19, RTL930X_L3_HW_LU_KEY_CTRL);
 	if (rt->attr.type) { /* IPv6 */
 		rtl930x_net6_mask(rt->prefix_len, &ip6_m);
 		for (int i = 0; i < 4; i++)
-			sw_w32(rt->dst_ip6.s6_addr32[0] & ip6_m.s6_addr32[0],
+			sw_w32(rt->dst_ip6.s6_addr32[i] & ip6_m.s6_addr32[i],
 			       RTL930X_L3_HW_LU_KEY_IP_CTRL + (i << 2));
 	} else { /* IPv4 */
 		ip4_m = inet_make_mask(rt->prefix_len);
@@ -1498,18 +1523,25 @@ static int rtl930x_route_lookup_hw(struct otto_l3_route *rt)
 	return -1;
 }
 
+/* Find the slot of a host route in the L3_HOST_ROUTE table. Returns the slot already holding
+ * the route's destination or, unless must_exist is set, the first free slot of its hash bucket.
+ */
 static int rtl930x_find_l3_slot(struct otto_l3_route *rt, bool must_exist)
 {
-	int slot_width, algorithm, addr, idx;
+	int slot_width, algorithm, addr, idx, free_idx = -1;
 	u32 hash;
 	struct otto_l3_route route_entry;
+	bool match;
 
 	/* IPv6 entries take up 3 slots */
 	slot_width = (rt->attr.type == 0) || (rt->attr.type == 2) ? 1 : 3;
 
 	for (int t = 0; t < 2; t++) {
 		algorithm = (sw_r32(RTL930X_L3_HOST_TBL_CTRL) >> (2 + t)) & 0x1;
-		hash = rtl930x_l3_hash4(rt->dst_ip, algorithm, false);
+		if (rt->attr.type == 2)
+			hash = rtl930x_l3_hash6(&rt->dst_ip6, algorithm, false);
+		else
+			hash = rtl930x_l3_hash4(rt->dst_ip, algorithm, false);
 
 		pr_debug("%s: table %d, algorithm %d, hash %04x\n", __func__, t, algorithm, hash);
 
@@ -1520,16 +1552,27 @@ static int rtl930x_find_l3_slot(struct otto_l3_route *rt, bool must_exist)
 			pr_debug("%s logical address %d\n", __func__, idx);
 
 			rtl930x_host_route_read(idx, &route_entry);
-			pr_debug("%s route valid %d, route dest: %pI4, hit %d\n", __func__,
-				 rt->attr.valid, &rt->dst_ip, rt->attr.hit);
-			if (!must_exist && rt->attr.valid)
-				return idx;
-			if (must_exist && route_entry.dst_ip == rt->dst_ip)
+			pr_debug("%s route valid %d, hit %d\n", __func__,
+				 route_entry.attr.valid, route_entry.attr.hit);
+			if (!route_entry.attr.valid) {
+				if (free_idx < 0)
+					free_idx = idx;
+				continue;
+			}
+
+			if (route_entry.attr.type != rt->attr.type)
+				continue;
+
+			if (rt->attr.type == 2)
+				match = ipv6_addr_equal(&route_entry.dst_ip6, &rt->dst_ip6);
+			else
+				match = route_entry.dst_ip == rt->dst_ip;
+			if (match)
 				return idx;
 		}
 	}
 
-	return -1;
+	return must_exist ? -1 : free_idx;
 }
 
 /* Write a prefix route into the routing table CAM at position idx
@@ -2159,6 +2202,7 @@ static int rtl930x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 		min_block = max_block;
 		max_block = priv->r->n_pie_blocks;
 	}
+	min_block = max(min_block, pr->min_block);
 	pr_debug("In %s\n", __func__);
 
 	mutex_lock(&priv->pie_mutex);
@@ -2177,7 +2221,7 @@ static int rtl930x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 			break;
 	}
 
-	if (block >= priv->r->n_pie_blocks) {
+	if (block >= max_block) {
 		mutex_unlock(&priv->pie_mutex);
 		return -EOPNOTSUPP;
 	}
@@ -2515,6 +2559,21 @@ static void rtl930x_packet_cntr_clear(int counter)
 	rtl_table_release(r);
 }
 
+static void rtl930x_log_table_read(int idx, int n, u32 *data)
+{
+	/* Read LOG table (3) via register RTL9300_TBL_0 */
+	struct table_reg *r = rtl_table_get(RTL9300_TBL_0, 3);
+
+	for (int i = 0; i < n; i++) {
+		rtl_table_read(r, idx + i);
+		/* The table has a size of 2 registers */
+		data[i * 2] = sw_r32(rtl_table_data(r, 0));
+		data[i * 2 + 1] = sw_r32(rtl_table_data(r, 1));
+	}
+
+	rtl_table_release(r);
+}
+
 static void rtl930x_vlan_port_keep_tag_set(int port, bool keep_outer, bool keep_inner)
 {
 	sw_w32(FIELD_PREP(RTL930X_VLAN_PORT_TAG_STS_CTRL_EGR_OTAG_STS_MASK,
@@ -2870,6 +2929,7 @@ const struct rtldsa_config rtldsa_930x_cfg = {
 	.port_rate_police_del = rtldsa_930x_port_rate_police_del,
 	.print_matrix = rtldsa_930x_print_matrix,
 	.read_l2_entry_using_hash = rtl930x_read_l2_entry_using_hash,
+	.read_l2_entries = rtl930x_read_l2_entries,
 	.write_l2_entry_using_hash = rtl930x_write_l2_entry_using_hash,
 	.read_cam = rtl930x_read_cam,
 	.write_cam = rtl930x_write_cam,
@@ -2892,9 +2952,11 @@ const struct rtldsa_config rtldsa_930x_cfg = {
 	.l2_learning_setup = rtl930x_l2_learning_setup,
 	.packet_cntr_read = rtl930x_packet_cntr_read,
 	.packet_cntr_clear = rtl930x_packet_cntr_clear,
+	.log_table_read = rtl930x_log_table_read,
 #ifdef CONFIG_NET_DSA_RTL83XX_RTL930X_L3_OFFLOAD
 	.route_read = rtl930x_route_read,
 	.route_write = rtl930x_route_write,
+	.host_route_read = rtl930x_host_route_read,
 	.host_route_write = rtl930x_host_route_write,
 	.l3_setup = rtl930x_l3_setup,
 	.set_l3_nexthop = rtl930x_set_l3_nexthop,
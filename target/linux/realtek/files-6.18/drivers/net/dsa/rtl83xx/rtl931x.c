@@ -822,6 +822,24 @@ static void rtl931x_write_cam(int idx, struct rtl838x_l2_entry *e)
 	rtl_table_release(q);
 }
 
+/* Read n consecutive entries of the L2 forwarding table starting at index idx
+ * while holding the table for the whole batch
+ */
+static void rtl931x_read_l2_entries(int idx, int n, struct rtl838x_l2_entry *e)
+{
+	u32 r[4];
+	struct table_reg *q = rtl_table_get(RTL9310_TBL_0, 0);
+
+	for (int j = 0; j < n; j++) {
+		rtl_table_read(q, idx + j);
+		for (int i = 0; i < 4; i++)
+			r[i] = sw_r32(rtl_table_data(q, i));
+		rtl931x_fill_l2_entry(r, &e[j]);
+	}
+
+	rtl_table_release(q);
+}
+
 static void rtl931x_write_l2_entry_using_hash(u32 hash, u32 pos, struct rtl838x_l2_entry *e)
 {
 	u32 r[4];
@@ -1402,6 +1420,7 @@ static int rtl931x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 		min_block = max_block;
 		max_block = priv->r->n_pie_blocks;
 	}
+	min_block = max(min_block, pr->min_block);
 	pr_debug("In %s\n", __func__);
 
 	mutex_lock(&priv->pie_mutex);
@@ -1421,7 +1440,7 @@ static int rtl931x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 			break;
 	}
 
-	if (block >= priv->r->n_pie_blocks) {
+	if (block >= max_block) {
 		mutex_unlock(&priv->pie_mutex);
 		return -EOPNOTSUPP;
 	}
@@ -2007,6 +2026,7 @@ const struct rtldsa_config rtldsa_931x_cfg = {
 	.port_rate_police_del = rtldsa_931x_port_rate_police_del,
 	.print_matrix = rtldsa_931x_print_matrix,
 	.read_l2_entry_using_hash = rtl931x_read_l2_entry_using_hash,
+	.read_l2_entries = rtl931x_read_l2_entries,
 	.write_l2_entry_using_hash = rtl931x_write_l2_entry_using_hash,
 	.read_cam = rtl931x_read_cam,
 	.write_cam = rtl931x_write_cam,
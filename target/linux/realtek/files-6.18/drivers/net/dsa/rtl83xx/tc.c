@@ -223,6 +223,60 @@ static int rtl83xx_add_flow(struct rtl838x_switch_priv *priv, struct flow_cls_of
 	return 0;
 }
 
+/* Set up a second rule with the same match fields as the flow, which only logs the
+ * bytes of the matching packets into an octet counter. Only the first hit in each
+ * PIE block takes effect, so the rule needs to go into a later block than the flow.
+ */
+static void rtl83xx_add_octet_rule(struct rtl838x_switch_priv *priv, struct rtl83xx_flow *flow)
+{
+	struct pie_rule *pr = &flow->octet_rule;
+	int cntr;
+
+	/* The RTL838x cannot log octets, and without log_table_read() the counter
+	 * would never be harvested
+	 */
+	if (priv->family_id == RTL8380_FAMILY_ID || !priv->r->log_table_read)
+		return;
+
+	cntr = rtl83xx_octet_cntr_alloc(priv);
+	if (cntr < 0)
+		return;
+
+	*pr = flow->rule;
+	pr->min_block = flow->rule.id / PIE_BLOCK_SIZE + 1;
+
+	pr->drop = false;
+	pr->fwd_sel = false;
+	pr->ovid_sel = false;
+	pr->ivid_sel = false;
+	pr->flt_sel = false;
+	pr->rmk_sel = false;
+	pr->meter_sel = false;
+	pr->tagst_sel = false;
+	pr->mir_sel = false;
+	pr->nopri_sel = false;
+	pr->cpupri_sel = false;
+	pr->otpid_sel = false;
+	pr->itpid_sel = false;
+	pr->shaper_sel = false;
+	pr->mpls_sel = false;
+	pr->bypass_sel = false;
+	pr->fwd_mod_to_cpu = false;
+
+	pr->log_sel = true;
+	pr->log_octets = true;
+	pr->log_data = cntr;
+
+	if (priv->r->pie_rule_add(priv, pr)) {
+		pr_debug("%s: no room for octet counting rule\n", __func__);
+		rtl83xx_octet_cntr_free(priv, cntr);
+		return;
+	}
+
+	pr_debug("Using octet counter %d\n", cntr);
+	flow->rule.octet_cntr = cntr;
+}
+
 static const struct rhashtable_params tc_ht_params = {
 	.head_offset = offsetof(struct rtl83xx_flow, node),
 	.key_offset = offsetof(struct rtl83xx_flow, cookie),
@@ -261,6 +315,8 @@ rcu_unlock:
 
 	flow->cookie = f->cookie;
 	flow->priv = priv;
+	flow->rule.octet_cntr = -1;
+	flow->lastused = jiffies;
 
 	err = rhashtable_insert_fast(&priv->tc_ht, &flow->node, tc_ht_params);
 	if (err) {
@@ -279,6 +335,9 @@ rcu_unlock:
 	}
 
 	err = priv->r->pie_rule_add(priv, &flow->rule);
+	if (!err)
+		rtl83xx_add_octet_rule(priv, flow);
+
 	return err;
 
 out_free:
@@ -297,19 +356,24 @@ static int rtl83xx_delete_flower(struct rtl838x_switch_priv *priv,
 	pr_debug("In %s\n", __func__);
 	rcu_read_lock();
 	flow = rhashtable_lookup_fast(&priv->tc_ht, &cls_flower->cookie, tc_ht_params);
-	if (!flow) {
+	if (!flow || rhashtable_remove_fast(&priv->tc_ht, &flow->node, tc_ht_params)) {
 		rcu_read_unlock();
 		return -EINVAL;
 	}
+	rcu_read_unlock();
 
+	/* The flow is unlinked now, the removal below takes mutexes and may sleep */
 	priv->r->pie_rule_rm(priv, &flow->rule);
+	if (flow->rule.packet_cntr >= 0)
+		rtl83xx_packet_cntr_free(priv, flow->rule.packet_cntr);
 
-	rhashtable_remove_fast(&priv->tc_ht, &flow->node, tc_ht_params);
+	if (flow->rule.octet_cntr >= 0) {
+		priv->r->pie_rule_rm(priv, &flow->octet_rule);
+		rtl83xx_octet_cntr_free(priv, flow->rule.octet_cntr);
+	}
 
 	kfree_rcu(flow, rcu_head);
 
-	rcu_read_unlock();
-
 	return 0;
 }
 
@@ -317,24 +381,33 @@ static int rtl83xx_stats_flower(struct rtl838x_switch_priv *priv,
 				struct flow_cls_offload *cls_flower)
 {
 	struct rtl83xx_flow *flow;
-	unsigned long lastused = 0;
-	int total_packets, new_packets;
+	u64 total, new_packets = 0, new_bytes = 0;
 
 	pr_debug("%s:\n", __func__);
 	flow = rhashtable_lookup_fast(&priv->tc_ht, &cls_flower->cookie, tc_ht_params);
 	if (!flow)
 		return -1;
 
+	/* The counters are harvested periodically, do not access the HW here */
 	if (flow->rule.packet_cntr >= 0) {
-		total_packets = priv->r->packet_cntr_read(flow->rule.packet_cntr);
-		pr_debug("Total packets: %d\n", total_packets);
-		new_packets = total_packets - flow->rule.last_packet_cnt;
-		flow->rule.last_packet_cnt = total_packets;
+		total = rtl83xx_packet_cntr_get(priv, flow->rule.packet_cntr);
+		pr_debug("Total packets: %llu\n", total);
+		new_packets = total - flow->rule.last_packet_cnt;
+		flow->rule.last_packet_cnt = total;
 	}
 
-	/* TODO: We need a second PIE rule to count the bytes */
-	flow_stats_update(&cls_flower->stats, 100 * new_packets, new_packets, 0, lastused,
-			  FLOW_ACTION_HW_STATS_IMMEDIATE);
+	if (flow->rule.octet_cntr >= 0) {
+		total = rtl83xx_octet_cntr_get(priv, flow->rule.octet_cntr);
+		pr_debug("Total bytes: %llu\n", total);
+		new_bytes = total - flow->rule.last_octet_cnt;
+		flow->rule.last_octet_cnt = total;
+	}
+
+	if (new_packets)
+		flow->lastused = jiffies;
+
+	flow_stats_update(&cls_flower->stats, new_bytes, new_packets, 0, flow->lastused,
+			  FLOW_ACTION_HW_STATS_DELAYED);
 
 	return 0;
 }
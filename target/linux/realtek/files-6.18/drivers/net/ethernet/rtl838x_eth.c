@@ -22,6 +22,7 @@
 #include <linux/regmap.h>
 #include <net/dsa.h>
 #include <net/dst_metadata.h>
+#include <net/netdev_queues.h>
 #include <net/page_pool/helpers.h>
 #include <net/switchdev.h>
 
@@ -35,8 +36,18 @@
 #define RTETH_RX_RINGS			2
 #define RTETH_TX_RING_SIZE		16
 #define RTETH_TX_RINGS			2
+#define RTETH_TX_WAKE_THRESH		(RTETH_TX_RING_SIZE / 4)
 #define RTETH_TX_TRIGGER(ctrl, ring)	((0x16 >> ring) & ctrl->r->tx_trigger_mask)
 
+/*
+ * The interrupt registers hold consecutive fields of RX run out (one bit per RX ring),
+ * RX done (one bit per RX ring), TX done (one bit per TX ring) and TX all done. RTL839x
+ * adds the L2 notifications. With their 32 RX rings RTL93xx spread this over multiple
+ * registers.
+ */
+#define RTETH_IRQ_RX_DONE(ctrl, ring)	((ctrl)->r->rx_rings + (ring))
+#define RTETH_IRQ_TX_DONE(ctrl, ring)	((ctrl)->r->rx_rings * 2 + (ring))
+
 #define NOTIFY_EVENTS			10
 #define NOTIFY_BLOCKS			10
 #define RX_TRUNCATE_EN_93XX		BIT(6)
@@ -70,7 +81,6 @@ struct rteth_rx {
 };
 
 struct rteth_tx {
-	int			slot;
 	dma_addr_t		ring[RTETH_TX_RING_SIZE];
 	struct rteth_packet	packet[RTETH_TX_RING_SIZE];
 };
@@ -102,6 +112,12 @@ struct rtl838x_rx_q {
 	struct page_pool *page_pool;
 };
 
+struct rtl838x_tx_q {
+	/* head is only advanced by rteth_start_xmit(), tail only by rteth_tx_reclaim() */
+	unsigned int head;
+	unsigned int tail;
+};
+
 struct rteth_ctrl {
 	struct regmap *map;
 	struct net_device *dev;
@@ -110,6 +126,7 @@ struct rteth_ctrl {
 	spinlock_t lock;
 	struct mii_bus *mii_bus;
 	struct rtl838x_rx_q rx_qs[RTETH_RX_RINGS];
+	struct rtl838x_tx_q tx_qs[RTETH_TX_RINGS];
 	struct phylink *phylink;
 	struct phylink_config phylink_config;
 	const struct rteth_config *r;
@@ -121,8 +138,9 @@ struct rteth_ctrl {
 	struct rteth_rx		*rx_data;
 	/* transmit handling */
 	dma_addr_t		tx_dma;
-	spinlock_t		tx_lock;
 	struct rteth_tx		*tx_data;
+	u32			dma_if_ctrl;
+	struct work_struct	tx_timeout_work;
 };
 
 static void rteth_838x_create_tx_header(struct rteth_packet *h, unsigned int port, int prio)
@@ -176,14 +194,22 @@ static void rteth_93xx_create_tx_header(struct rteth_packet *h, unsigned int por
 
 static inline void rteth_reenable_irq(struct rteth_ctrl *ctrl, int ring)
 {
-	u32 shift = ctrl->r->rx_rings % 32;
-	u32 reg = ctrl->r->rx_rings / 32;
-	u32 bit = BIT(ring + shift);
+	u32 rx = RTETH_IRQ_RX_DONE(ctrl, ring);
+	u32 tx = RTETH_IRQ_TX_DONE(ctrl, ring);
 	unsigned long flags;
 
 	/* locking needed for synchronization with rteth_confirm_and_disable_irqs() */
 	spin_lock_irqsave(&ctrl->lock, flags);
-	regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + reg * 4, bit, bit);
+	if (rx / 32 == tx / 32) {
+		u32 bits = BIT(rx % 32) | BIT(tx % 32);
+
+		regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + (rx / 32) * 4, bits, bits);
+	} else {
+		regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + (rx / 32) * 4,
+				   BIT(rx % 32), BIT(rx % 32));
+		regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + (tx / 32) * 4,
+				   BIT(tx % 32), BIT(tx % 32));
+	}
 	spin_unlock_irqrestore(&ctrl->lock, flags);
 }
 
@@ -193,20 +219,34 @@ static inline void rteth_confirm_and_disable_irqs(struct rteth_ctrl *ctrl,
 	u32 mask = GENMASK(ctrl->r->rx_rings - 1, 0);
 	u32 shift = ctrl->r->rx_rings % 32;
 	u32 reg = ctrl->r->rx_rings / 32;
+	u32 tx_mask = GENMASK(RTETH_TX_RINGS - 1, 0);
+	u32 tx_shift = RTETH_IRQ_TX_DONE(ctrl, 0) % 32;
+	u32 tx_reg = RTETH_IRQ_TX_DONE(ctrl, 0) / 32;
+	u32 active, tx_active, disable;
 	unsigned long flags;
-	u32 active;
 
-	/* get all irqs, disable only rx (on RTL839x this keeps L2), confirm all */
+	/* get all irqs, disable only rx/tx done (on RTL839x this keeps L2), confirm all */
 	spin_lock_irqsave(&ctrl->lock, flags);
 	regmap_read(ctrl->map, ctrl->r->dma_if_intr_sts + reg * 4, &active);
-	regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + reg * 4,
-			   active & (mask << shift), 0);
+	disable = mask << shift;
+	if (tx_reg == reg)
+		disable |= tx_mask << tx_shift;
+	regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + reg * 4, active & disable, 0);
 	regmap_write(ctrl->map, ctrl->r->dma_if_intr_sts + reg * 4, active);
+
+	tx_active = active;
+	if (tx_reg != reg) {
+		regmap_read(ctrl->map, ctrl->r->dma_if_intr_sts + tx_reg * 4, &tx_active);
+		regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + tx_reg * 4,
+				   tx_active & (tx_mask << tx_shift), 0);
+		regmap_write(ctrl->map, ctrl->r->dma_if_intr_sts + tx_reg * 4, tx_active);
+	}
 	spin_unlock_irqrestore(&ctrl->lock, flags);
 
 	/* ~mask filters out RTL93xx devices */
 	*l2 = !!(active & ~mask & RTL839X_DMA_IF_INTR_NOTIFY_MASK);
-	*rings = (active >> shift) & mask;
+	/* RX and TX ring n are served by the same NAPI instance */
+	*rings = ((active >> shift) & mask) | ((tx_active >> tx_shift) & tx_mask);
 }
 
 static void rteth_disable_all_irqs(struct rteth_ctrl *ctrl)
@@ -219,19 +259,24 @@ static void rteth_disable_all_irqs(struct rteth_ctrl *ctrl)
 	}
 }
 
-static void rteth_enable_all_rx_irqs(struct rteth_ctrl *ctrl)
+static void rteth_enable_all_irqs(struct rteth_ctrl *ctrl)
 {
 	int mask, reg;
 
 	/*
 	 * The hardware has several types of interrupts. Basically for rx/tx completion and
-	 * if hardware queues run out. For now the driver only needs notification about new
-	 * incoming packets. Leave everything else disabled.
+	 * if hardware queues run out. The driver needs notification about new incoming
+	 * packets and about sent packets, so that NAPI can reclaim the TX ring. Leave
+	 * everything else disabled.
 	 */
 	mask = GENMASK(ctrl->r->rx_rings - 1, 0) << (ctrl->r->rx_rings % 32);
 	reg = ctrl->r->rx_rings / 32;
 	regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + reg * 4, mask, mask);
 
+	mask = GENMASK(RTETH_TX_RINGS - 1, 0) << (RTETH_IRQ_TX_DONE(ctrl, 0) % 32);
+	reg = RTETH_IRQ_TX_DONE(ctrl, 0) / 32;
+	regmap_update_bits(ctrl->map, ctrl->r->dma_if_intr_msk + reg * 4, mask, mask);
+
 	/*
 	 * RTL839x has additional L2 notification interrupts. Simply activate them. All other
 	 * devices that do not have the feature have adequate reserved bit space and ignore it.
@@ -388,7 +433,7 @@ static irqreturn_t rteth_net_irq(int irq, void *dev_id)
 
 	rteth_confirm_and_disable_irqs(ctrl, &rings, &l2);
 	for_each_set_bit(ring, &rings, RTETH_RX_RINGS) {
-		netdev_dbg(dev, "schedule rx ring %lu\n", ring);
+		netdev_dbg(dev, "schedule ring %lu\n", ring);
 		napi_schedule(&ctrl->rx_qs[ring].napi);
 	}
 
@@ -534,7 +579,7 @@ static void rteth_838x_hw_en_rxtx(struct rteth_ctrl *ctrl)
 	regmap_write(ctrl->map, ctrl->r->dma_if_ctrl,
 		     (DEFAULT_MTU << 16) | RX_TRUNCATE_EN_83XX | TX_PAD_EN_838X);
 
-	rteth_enable_all_rx_irqs(ctrl);
+	rteth_enable_all_irqs(ctrl);
 
 	/* Enable DMA, engine expects empty FCS field */
 	regmap_update_bits(ctrl->map, ctrl->r->dma_if_ctrl,
@@ -558,7 +603,7 @@ static void rteth_839x_hw_en_rxtx(struct rteth_ctrl *ctrl)
 	/* Setup CPU-Port: RX Buffer */
 	regmap_write(ctrl->map, ctrl->r->dma_if_ctrl, (DEFAULT_MTU << 5) | RX_TRUNCATE_EN_83XX);
 
-	rteth_enable_all_rx_irqs(ctrl);
+	rteth_enable_all_irqs(ctrl);
 
 	/* Enable DMA */
 	regmap_update_bits(ctrl->map, ctrl->r->dma_if_ctrl,
@@ -582,7 +627,7 @@ static void rteth_930x_hw_en_rxtx(struct rteth_ctrl *ctrl)
 	/* Setup CPU-Port: RX Buffer truncated at DEFAULT_MTU Bytes */
 	regmap_write(ctrl->map, ctrl->r->dma_if_ctrl, (DEFAULT_MTU << 16) | RX_TRUNCATE_EN_93XX);
 
-	rteth_enable_all_rx_irqs(ctrl);
+	rteth_enable_all_irqs(ctrl);
 
 	/* Enable DMA */
 	regmap_set_bits(ctrl->map, ctrl->r->dma_if_ctrl, ctrl->r->tx_rx_enable);
@@ -599,7 +644,7 @@ static void rteth_931x_hw_en_rxtx(struct rteth_ctrl *ctrl)
 	/* Setup CPU-Port: RX Buffer truncated at DEFAULT_MTU Bytes */
 	regmap_write(ctrl->map, ctrl->r->dma_if_ctrl, (DEFAULT_MTU << 16) | RX_TRUNCATE_EN_93XX);
 
-	rteth_enable_all_rx_irqs(ctrl);
+	rteth_enable_all_irqs(ctrl);
 
 	/* Enable DMA */
 	regmap_set_bits(ctrl->map, ctrl->r->dma_if_ctrl, ctrl->r->tx_rx_enable);
@@ -701,7 +746,9 @@ static int rteth_setup_ring_buffer(struct rteth_ctrl *ctrl)
 		}
 
 		ctrl->tx_data[r].ring[RTETH_TX_RING_SIZE - 1] |= RING_WRAP;
-		ctrl->tx_data[r].slot = 0;
+		ctrl->tx_qs[r].head = 0;
+		ctrl->tx_qs[r].tail = 0;
+		netdev_tx_reset_queue(netdev_get_tx_queue(ctrl->dev, r));
 	}
 
 	if (highmem)
@@ -771,6 +818,24 @@ static void rteth_931x_hw_init(struct rteth_ctrl *ctrl)
 	regmap_set_bits(ctrl->map, RTL931X_PS_SOC_CTRL, BIT(1));
 }
 
+static void rteth_save_dma_if_ctrl(struct rteth_ctrl *ctrl)
+{
+	u32 val;
+
+	/*
+	 * The TX triggers share the DMA interface control register with settings that do not
+	 * change while the interface is up. Remember these once, so that rteth_tx_trigger()
+	 * can go without a read-modify-write. On some SoCs (especially RTL838x) there is a
+	 * known bug, where the hardware sometimes reads empty values from the register. Work
+	 * around that with a poll that checks if TX/RX is enabled in the register.
+	 */
+	if (regmap_read_poll_timeout(ctrl->map, ctrl->r->dma_if_ctrl,
+				     val, val & ctrl->r->tx_rx_enable, 0, 5000))
+		netdev_warn(ctrl->dev, "DMA interface ctrl register read failed\n");
+
+	WRITE_ONCE(ctrl->dma_if_ctrl, val & ~ctrl->r->tx_trigger_mask);
+}
+
 static int rteth_open(struct net_device *dev)
 {
 	struct rteth_ctrl *ctrl = netdev_priv(dev);
@@ -797,6 +862,7 @@ static int rteth_open(struct net_device *dev)
 
 		ctrl->r->hw_init(ctrl);
 		ctrl->r->hw_en_rxtx(ctrl);
+		rteth_save_dma_if_ctrl(ctrl);
 		netif_tx_start_all_queues(dev);
 	}
 
@@ -882,6 +948,7 @@ static int rteth_stop(struct net_device *dev)
 
 	pr_info("in %s\n", __func__);
 
+	netif_tx_disable(dev);
 	phylink_stop(ctrl->phylink);
 	rteth_hw_stop(ctrl);
 
@@ -890,7 +957,6 @@ static int rteth_stop(struct net_device *dev)
 
 	rteth_free_tx_buffers(ctrl);
 	rteth_free_rx_buffers(ctrl);
-	netif_tx_stop_all_queues(dev);
 
 	return 0;
 }
@@ -982,25 +1048,59 @@ static void rteth_931x_set_rx_mode(struct net_device *dev)
 	}
 }
 
-static void rteth_tx_timeout(struct net_device *dev, unsigned int txqueue)
+static void rteth_tx_timeout_work(struct work_struct *work)
 {
-	struct rteth_ctrl *ctrl = netdev_priv(dev);
+	struct rteth_ctrl *ctrl = container_of(work, struct rteth_ctrl, tx_timeout_work);
+	struct net_device *dev = ctrl->dev;
+	int ret = 0;
+
+	rtnl_lock();
+	if (!netif_running(dev))
+		goto out;
+
+	/* NAPI reclaims the TX rings, so it must be quiesced together with xmit */
+	netif_tx_disable(dev);
+	for (int i = 0; i < RTETH_RX_RINGS; i++)
+		napi_disable(&ctrl->rx_qs[i].napi);
 
-	pr_warn("%s\n", __func__);
 	scoped_guard(spinlock_irqsave, &ctrl->lock) {
 		rteth_hw_stop(ctrl);
 		rteth_free_tx_buffers(ctrl);
 		rteth_free_rx_buffers(ctrl);
-		if (rteth_setup_ring_buffer(ctrl)) {
-			netdev_err(dev, "tx_timeout recovery failed, bringing interface down\n");
-			netif_device_detach(dev);
-			return;
+		ret = rteth_setup_ring_buffer(ctrl);
+		if (!ret)
+			rteth_hw_ring_setup(ctrl);
+	}
+
+	/* napi_enable() may sleep, enable before the DMA starts raising interrupts */
+	for (int i = 0; i < RTETH_RX_RINGS; i++)
+		napi_enable(&ctrl->rx_qs[i].napi);
+
+	if (!ret) {
+		scoped_guard(spinlock_irqsave, &ctrl->lock) {
+			ctrl->r->hw_en_rxtx(ctrl);
+			rteth_save_dma_if_ctrl(ctrl);
 		}
-		rteth_hw_ring_setup(ctrl);
-		ctrl->r->hw_en_rxtx(ctrl);
-		netif_trans_update(dev);
-		netif_start_queue(dev);
 	}
+
+	if (ret) {
+		netdev_err(dev, "tx_timeout recovery failed, bringing interface down\n");
+		netif_device_detach(dev);
+		goto out;
+	}
+
+	netif_trans_update(dev);
+	netif_tx_wake_all_queues(dev);
+out:
+	rtnl_unlock();
+}
+
+static void rteth_tx_timeout(struct net_device *dev, unsigned int txqueue)
+{
+	struct rteth_ctrl *ctrl = netdev_priv(dev);
+
+	netdev_warn(dev, "tx ring %u timed out\n", txqueue);
+	schedule_work(&ctrl->tx_timeout_work);
 }
 
 static int rteth_get_dsa_port(struct sk_buff *skb, struct net_device *dev)
@@ -1019,50 +1119,62 @@ static int rteth_get_dsa_port(struct sk_buff *skb, struct net_device *dev)
 	return -1;
 }
 
-static int rteth_start_xmit(struct sk_buff *skb, struct net_device *dev)
+static inline unsigned int rteth_tx_free(struct rtl838x_tx_q *tx_q)
 {
-	int port, val, slot, len = skb->len, ring = skb_get_queue_mapping(skb);
+	return RTETH_TX_RING_SIZE - (READ_ONCE(tx_q->head) - READ_ONCE(tx_q->tail));
+}
+
+static inline void rteth_tx_trigger(struct rteth_ctrl *ctrl, int ring)
+{
+	/* Make sure the descriptors are visible before the DMA engine is kicked */
+	wmb();
+	regmap_write(ctrl->map, ctrl->r->dma_if_ctrl,
+		     READ_ONCE(ctrl->dma_if_ctrl) | RTETH_TX_TRIGGER(ctrl, ring));
+}
+
+static netdev_tx_t rteth_start_xmit(struct sk_buff *skb, struct net_device *dev)
+{
+	int port, slot, len = skb->len, ring = skb_get_queue_mapping(skb);
+	struct netdev_queue *txq = netdev_get_tx_queue(dev, ring);
 	struct rteth_ctrl *ctrl = netdev_priv(dev);
+	struct rtl838x_tx_q *tx_q = &ctrl->tx_qs[ring];
 	struct rteth_packet *packet;
 	dma_addr_t packet_dma;
 
+	/*
+	 * Each TX ring is only fed from its own netdev queue, so the queue lock taken by the
+	 * stack is all the serialization needed here. Completed slots are freed by NAPI.
+	 */
 	port = rteth_get_dsa_port(skb, dev);
 	if (port < 0)
 		len += ETH_FCS_LEN; /* No reusable 4 byte tag, add space for 4 byte layer 2 FCS */
 
 	len = max(ETH_ZLEN + ETH_FCS_LEN, len);
 	if (unlikely(skb_put_padto(skb, len))) {
-		dev->stats.tx_errors++;
+		DEV_STATS_INC(dev, tx_errors);
 		netdev_warn(dev, "skb pad failed\n");
 
-		return NETDEV_TX_OK;
+		goto out_kick;
 	}
 
-	slot = ctrl->tx_data[ring].slot;
-	packet = &ctrl->tx_data[ring].packet[slot];
-	packet_dma = ctrl->tx_data[ring].ring[slot];
-
-	if (unlikely(packet_dma & RING_OWN_HW)) {
-		netif_stop_subqueue(dev, ring);
+	if (unlikely(!rteth_tx_free(tx_q))) {
+		netif_tx_stop_queue(txq);
 		if (net_ratelimit())
-			netdev_warn(dev, "tx ring %d busy, waiting for slot %d\n", ring, slot);
+			netdev_warn(dev, "tx ring %d busy\n", ring);
 
 		return NETDEV_TX_BUSY;
 	}
 
-	if (likely(packet->skb)) {
-		/* cleanup old data of this slot */
-		dma_unmap_single(&ctrl->pdev->dev, packet->dma, packet->skb->len, DMA_TO_DEVICE);
-		dev_consume_skb_any(packet->skb);
-	}
+	slot = tx_q->head % RTETH_TX_RING_SIZE;
+	packet = &ctrl->tx_data[ring].packet[slot];
+	packet_dma = ctrl->tx_data[ring].ring[slot];
 
 	packet->dma = dma_map_single(&ctrl->pdev->dev, skb->data, len, DMA_TO_DEVICE);
 	if (unlikely(dma_mapping_error(&ctrl->pdev->dev, packet->dma))) {
 		dev_kfree_skb_any(skb);
-		packet->skb = NULL;
-		dev->stats.tx_errors++;
+		DEV_STATS_INC(dev, tx_errors);
 
-		return NETDEV_TX_OK;
+		goto out_kick;
 	}
 
 	if (port >= 0)
@@ -1073,30 +1185,60 @@ static int rteth_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	packet->skb = skb;
 	dma_wmb();
 	ctrl->tx_data[ring].ring[slot] = packet_dma | RING_OWN_HW;
-	ctrl->tx_data[ring].slot = (slot + 1) % RTETH_TX_RING_SIZE;
-	wmb();
 
-	spin_lock(&ctrl->tx_lock);
+	/* pairs with smp_load_acquire() in rteth_tx_reclaim() */
+	smp_store_release(&tx_q->head, tx_q->head + 1);
+	dev_sw_netstats_tx_add(dev, 1, len - ETH_FCS_LEN);
 
-	/*
-	 * Issue send for 1 or 2 triggers. On some SoCs (especially RTL838x) there is a known
-	 * bug, where the hardware sometimes reads empty values from the register. Work around
-	 * that with a poll that checks if TX/RX is enabled in the register.
-	 */
-	if (regmap_read_poll_timeout(ctrl->map, ctrl->r->dma_if_ctrl,
-				     val, val & ctrl->r->tx_rx_enable, 0, 5000))
-		netdev_warn_once(dev, "DMA interface ctrl register read failed\n");
+	netif_txq_maybe_stop(txq, rteth_tx_free(tx_q), 1, RTETH_TX_WAKE_THRESH);
 
-	regmap_write(ctrl->map, ctrl->r->dma_if_ctrl, val | RTETH_TX_TRIGGER(ctrl, ring));
+	/* Issue the trigger only once for a burst of packets */
+	if (__netdev_tx_sent_queue(txq, len, netdev_xmit_more()))
+		rteth_tx_trigger(ctrl, ring);
 
-	dev->stats.tx_packets++;
-	dev->stats.tx_bytes += len - ETH_FCS_LEN;
+	return NETDEV_TX_OK;
 
-	spin_unlock(&ctrl->tx_lock);
+out_kick:
+	/* Do not leave packets of a previous xmit_more burst behind */
+	if (!netdev_xmit_more())
+		rteth_tx_trigger(ctrl, ring);
 
 	return NETDEV_TX_OK;
 }
 
+static void rteth_tx_reclaim(struct rteth_ctrl *ctrl, int ring, int budget)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(ctrl->dev, ring);
+	struct rtl838x_tx_q *tx_q = &ctrl->tx_qs[ring];
+	unsigned int head, tail = tx_q->tail;
+	unsigned int packets = 0, bytes = 0;
+	struct rteth_packet *packet;
+	int slot;
+
+	/* pairs with smp_store_release() in rteth_start_xmit() */
+	head = smp_load_acquire(&tx_q->head);
+
+	while (tail != head) {
+		slot = tail % RTETH_TX_RING_SIZE;
+		if (ctrl->tx_data[ring].ring[slot] & RING_OWN_HW)
+			break;
+
+		packet = &ctrl->tx_data[ring].packet[slot];
+		dma_unmap_single(&ctrl->pdev->dev, packet->dma, packet->skb->len, DMA_TO_DEVICE);
+		bytes += packet->skb->len;
+		packets++;
+		napi_consume_skb(packet->skb, budget);
+		packet->skb = NULL;
+		tail++;
+	}
+
+	if (!packets)
+		return;
+
+	WRITE_ONCE(tx_q->tail, tail);
+	netif_txq_completed_wake(txq, packets, bytes, rteth_tx_free(tx_q), RTETH_TX_WAKE_THRESH);
+}
+
 static int rteth_hw_receive(struct net_device *dev, int ring, int budget)
 {
 	int slot, work_done = 0, rx_packets = 0, rx_bytes = 0;
@@ -1189,12 +1331,14 @@ recycle:
 	return work_done;
 }
 
-static int rteth_poll_rx(struct napi_struct *napi, int budget)
+static int rteth_poll(struct napi_struct *napi, int budget)
 {
 	struct rtl838x_rx_q *rx_q = container_of(napi, struct rtl838x_rx_q, napi);
 	struct rteth_ctrl *ctrl = rx_q->ctrl;
 	int work_done, ring = rx_q->id;
 
+	rteth_tx_reclaim(ctrl, ring, budget);
+
 	work_done = rteth_hw_receive(ctrl->dev, ring, budget);
 	if (work_done < budget && napi_complete_done(napi, work_done))
 		rteth_reenable_irq(ctrl, ring);
@@ -1414,6 +1558,7 @@ static const struct net_device_ops rteth_838x_netdev_ops = {
 	.ndo_open = rteth_open,
 	.ndo_stop = rteth_stop,
 	.ndo_start_xmit = rteth_start_xmit,
+	.ndo_get_stats64 = dev_get_tstats64,
 	.ndo_set_mac_address = rteth_set_mac_address,
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rteth_838x_set_rx_mode,
@@ -1460,6 +1605,7 @@ static const struct net_device_ops rteth_839x_netdev_ops = {
 	.ndo_open = rteth_open,
 	.ndo_stop = rteth_stop,
 	.ndo_start_xmit = rteth_start_xmit,
+	.ndo_get_stats64 = dev_get_tstats64,
 	.ndo_set_mac_address = rteth_set_mac_address,
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rteth_839x_set_rx_mode,
@@ -1505,6 +1651,7 @@ static const struct net_device_ops rteth_930x_netdev_ops = {
 	.ndo_open = rteth_open,
 	.ndo_stop = rteth_stop,
 	.ndo_start_xmit = rteth_start_xmit,
+	.ndo_get_stats64 = dev_get_tstats64,
 	.ndo_set_mac_address = rteth_set_mac_address,
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rteth_930x_set_rx_mode,
@@ -1550,6 +1697,7 @@ static const struct net_device_ops rteth_931x_netdev_ops = {
 	.ndo_open = rteth_open,
 	.ndo_stop = rteth_stop,
 	.ndo_start_xmit = rteth_start_xmit,
+	.ndo_get_stats64 = dev_get_tstats64,
 	.ndo_set_mac_address = rteth_set_mac_address,
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rteth_931x_set_rx_mode,
@@ -1682,7 +1830,7 @@ static int rteth_probe(struct platform_device *pdev)
 
 	spin_lock_init(&ctrl->lock);
 	spin_lock_init(&ctrl->rx_lock);
-	spin_lock_init(&ctrl->tx_lock);
+	INIT_WORK(&ctrl->tx_timeout_work, rteth_tx_timeout_work);
 
 	dev->ethtool_ops = &rteth_ethtool_ops;
 	dev->min_mtu = ETH_ZLEN;
@@ -1690,6 +1838,7 @@ static int rteth_probe(struct platform_device *pdev)
 	dev->features = NETIF_F_RXCSUM;
 	dev->hw_features = NETIF_F_RXCSUM;
 	dev->netdev_ops = ctrl->r->netdev_ops;
+	dev->pcpu_stat_type = NETDEV_PCPU_STAT_TSTATS;
 
 	/* Obtain device IRQ number */
 	dev->irq = platform_get_irq(pdev, 0);
@@ -1742,10 +1891,12 @@ static int rteth_probe(struct platform_device *pdev)
 	dev_info(&pdev->dev, "Using MAC %pM\n", dev->dev_addr);
 	strscpy(dev->name, "eth%d", sizeof(dev->name));
 
+	/* RX ring n and TX ring n are served by the same NAPI instance */
+	BUILD_BUG_ON(RTETH_TX_RINGS != RTETH_RX_RINGS);
 	for (int i = 0; i < RTETH_RX_RINGS; i++) {
 		ctrl->rx_qs[i].id = i;
 		ctrl->rx_qs[i].ctrl = ctrl;
-		netif_napi_add(dev, &ctrl->rx_qs[i].napi, rteth_poll_rx);
+		netif_napi_add(dev, &ctrl->rx_qs[i].napi, rteth_poll);
 	}
 
 	platform_set_drvdata(pdev, dev);
@@ -1814,6 +1965,7 @@ static void rteth_remove(struct platform_device *pdev)
 
 	pr_info("Removing platform driver for rtl838x-eth\n");
 	unregister_netdev(dev);
+	cancel_work_sync(&ctrl->tx_timeout_work);
 	rteth_metadata_dst_free(ctrl);
 
 	if (ctrl->phylink)